@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#if !defined ARCH_WIN
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace RSBATechModules {
+
+/*
+Read-only contents of a file.
+
+The file is memory mapped, so only the pages that are actually read are loaded from disk. On Windows it is read
+into memory instead. Replacing the file by renaming another one over it does not affect an open MappedFile.
+*/
+
+struct MappedFile {
+	MappedFile() {}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		close();
+#if defined ARCH_WIN
+		FILE* file = std::fopen(path.c_str(), "rb");
+		if (!file) return false;
+		std::fseek(file, 0, SEEK_END);
+		long size = std::ftell(file);
+		std::fseek(file, 0, SEEK_SET);
+		if (size > 0) {
+			buffer.resize(size);
+			if (std::fread(buffer.data(), 1, size, file) != (size_t)size) size = -1;
+		}
+		std::fclose(file);
+		if (size <= 0) {
+			buffer.clear();
+			return false;
+		}
+		bytes = buffer.data();
+		length = buffer.size();
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+			::close(fd);
+			return false;
+		}
+		void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping stays valid after its file descriptor is closed
+		::close(fd);
+		if (p == MAP_FAILED) return false;
+		bytes = (const char*)p;
+		length = st.st_size;
+#endif
+		return true;
+	}
+
+	void close() {
+#if defined ARCH_WIN
+		buffer.clear();
+		buffer.shrink_to_fit();
+#else
+		if (bytes) munmap((void*)bytes, length);
+#endif
+		bytes = NULL;
+		length = 0;
+	}
+
+	const char* data() const {
+		return bytes;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+   private:
+	const char* bytes = NULL;
+	size_t length = 0;
+#if defined ARCH_WIN
+	std::vector<char> buffer;
+#endif
+};
+
+} // namespace RSBATechModules
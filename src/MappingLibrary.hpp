@@ -0,0 +1,953 @@
+#pragma once
+#include "plugin.hpp"
+#include "RSBATechModules.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <sys/stat.h>
+
+namespace RSBATechModules {
+
+/*
+Library of module mappings, keyed by plugin slug and module slug.
+
+Stored flat instead of as a std::map of heap allocated MemModules with lists of heap allocated MemParams:
+
+* every string (slugs, display names, page and parameter labels) is interned once and referred to by id
+* the entries sit in one array, found through an open addressing hash table of their (plugin, module) slug ids
+* the params of all entries sit in one array, each entry owning a contiguous slice of it
+
+Replacing or erasing an entry leaves its slice unused until enough params are unused to compact the array.
+Interned strings are only released by clear(), which the library loaders call first.
+
+As the tables hold no pointers they can be written to a binary image with saveImage(), and loadImage() maps
+such an image and reads the tables in place, so loading a library does not parse or copy anything. The first
+change to a library loaded from an image copies its tables into memory of its own.
+
+loadIndex() reads a library JSON file index first: it maps the file and only records the slugs, names and byte
+range of each module, and get() decodes the params and page labels of a module from the file when they are
+needed. Images keep such entries undecoded, pointing into the same file.
+*/
+
+struct MappingLibrary {
+	struct Param {
+		int paramId;
+		int nprn;
+		NPRNMODE nprnMode;
+		/** Interned label */
+		int label;
+		int midiOptions;
+		float slew;
+		float min;
+		float max;
+	};
+
+	struct Entry {
+		/** Interned slugs and display names */
+		int pluginSlug;
+		int moduleSlug;
+		int pluginName;
+		int moduleName;
+		bool autoMapped;
+		/** Interned page labels */
+		int pageLabels[MAX_PAGES];
+		/** Slice of the param array */
+		int paramBegin;
+		int paramCount;
+		/** Byte range of the entry in the source JSON file if it is not decoded, else -1 */
+		int sourceOffset;
+		int sourceLength;
+	};
+
+	/** A module mapping as passed to set(). Loaders reuse one instance, so its param vector is allocated once. */
+	struct Mapping {
+		std::string pluginName;
+		std::string moduleName;
+		bool autoMapped = false;
+		std::array<std::string, MAX_PAGES> pageLabels;
+		std::vector<MemParam> params;
+
+		void reset() {
+			pluginName.clear();
+			moduleName.clear();
+			autoMapped = false;
+			for (std::string& it : pageLabels) it.clear();
+			params.clear();
+		}
+	};
+
+	struct Params {
+		const Param* first;
+		const Param* last;
+		const Param* begin() const { return first; }
+		const Param* end() const { return last; }
+	};
+
+	/** Version of the library file a binary image was made from */
+	struct SourceKey {
+		uint64_t size;
+		int64_t modifiedTime;
+		uint32_t pathHash;
+	};
+
+	MappingLibrary() {
+		clear();
+	}
+
+	MappingLibrary(const MappingLibrary& other) {
+		*this = other;
+	}
+
+	MappingLibrary& operator=(const MappingLibrary& other) {
+		chars = other.chars;
+		stringOffsets = other.stringOffsets;
+		stringSlots = other.stringSlots;
+		entries = other.entries;
+		entrySlots = other.entrySlots;
+		params = other.params;
+		unusedParams = other.unusedParams;
+		image = other.image;
+		source = other.source;
+		sourceKey = other.sourceKey;
+		t = other.t;
+		refresh();
+		return *this;
+	}
+
+	void clear() {
+		image.reset();
+		source.reset();
+		sourceKey = SourceKey();
+		chars.clear();
+		stringOffsets.assign(1, 0);
+		stringSlots.assign(64, -1);
+		entries.clear();
+		entrySlots.assign(64, -1);
+		params.clear();
+		unusedParams = 0;
+		refresh();
+	}
+
+	int size() const {
+		return t.entryCount;
+	}
+
+	/** The entry of a module, or NULL. Only valid until the library is changed. */
+	const Entry* find(const std::string& pluginSlug, const std::string& moduleSlug) const {
+		int p = findString(pluginSlug);
+		if (p < 0) return NULL;
+		int m = findString(moduleSlug);
+		if (m < 0) return NULL;
+		int e = t.entrySlots[findEntrySlot(p, m)];
+		return e >= 0 ? &t.entries[e] : NULL;
+	}
+
+	std::string str(int id) const {
+		size_t len;
+		const char* s = getChars(id, len);
+		return std::string(s, len);
+	}
+
+	/**
+	 * Copies the mapping of an entry into `mapping`, decoding it from the source file if it is not decoded.
+	 * Returns false if it can not be decoded.
+	 */
+	bool get(const Entry& e, Mapping& mapping) const {
+		mapping.reset();
+		if (e.sourceOffset >= 0) {
+			std::string pluginSlug, moduleSlug;
+			return decodeSource(e, pluginSlug, moduleSlug, mapping);
+		}
+		mapping.pluginName = str(e.pluginName);
+		mapping.moduleName = str(e.moduleName);
+		mapping.autoMapped = e.autoMapped;
+		for (int i = 0; i < MAX_PAGES; i++) {
+			mapping.pageLabels[i] = str(e.pageLabels[i]);
+		}
+		for (const Param& it : getParams(e)) {
+			MemParam p;
+			p.paramId = it.paramId;
+			p.nprn = it.nprn;
+			p.nprnMode = it.nprnMode;
+			p.label = str(it.label);
+			p.midiOptions = it.midiOptions;
+			p.slew = it.slew;
+			p.min = it.min;
+			p.max = it.max;
+			mapping.params.push_back(p);
+		}
+		return true;
+	}
+
+	/** All entries ordered by plugin slug, then module slug */
+	std::vector<const Entry*> sorted() const {
+		std::vector<const Entry*> v;
+		v.reserve(t.entryCount);
+		for (int i = 0; i < t.entryCount; i++) v.push_back(&t.entries[i]);
+		std::sort(v.begin(), v.end(), [this](const Entry* a, const Entry* b) {
+			int c = compare(a->pluginSlug, b->pluginSlug);
+			return c != 0 ? c < 0 : compare(a->moduleSlug, b->moduleSlug) < 0;
+		});
+		return v;
+	}
+
+	/** Adds the mapping of a module, replacing any it had */
+	void set(const std::string& pluginSlug, const std::string& moduleSlug, const Mapping& mapping) {
+		own();
+		Entry e;
+		e.pluginSlug = intern(pluginSlug);
+		e.moduleSlug = intern(moduleSlug);
+		e.pluginName = intern(mapping.pluginName);
+		e.moduleName = intern(mapping.moduleName);
+		e.autoMapped = mapping.autoMapped;
+		for (int i = 0; i < MAX_PAGES; i++) {
+			e.pageLabels[i] = intern(mapping.pageLabels[i]);
+		}
+		e.paramBegin = (int)params.size();
+		e.paramCount = (int)mapping.params.size();
+		e.sourceOffset = -1;
+		e.sourceLength = 0;
+		for (const MemParam& it : mapping.params) {
+			Param p;
+			p.paramId = it.paramId;
+			p.nprn = it.nprn;
+			p.nprnMode = it.nprnMode;
+			p.label = intern(it.label);
+			p.midiOptions = it.midiOptions;
+			p.slew = it.slew;
+			p.min = it.min;
+			p.max = it.max;
+			params.push_back(p);
+		}
+		add(e);
+	}
+
+	/** Returns false if the module has no mapping */
+	bool erase(const std::string& pluginSlug, const std::string& moduleSlug) {
+		if (!find(pluginSlug, moduleSlug)) return false;
+		own();
+		size_t i = find(pluginSlug, moduleSlug) - entries.data();
+		unusedParams += entries[i].paramCount;
+		entries[i] = entries.back();
+		entries.pop_back();
+		rebuildEntrySlots();
+		compactIfSparse();
+		return true;
+	}
+
+	/** Erases the mappings of all modules of a plugin, returns how many */
+	int erasePlugin(const std::string& pluginSlug) {
+		int p = findString(pluginSlug);
+		if (p < 0) return 0;
+		own();
+		size_t n = entries.size();
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [this, p](const Entry& e) {
+			if (e.pluginSlug != p) return false;
+			unusedParams += e.paramCount;
+			return true;
+		}), entries.end());
+		n -= entries.size();
+		rebuildEntrySlots();
+		compactIfSparse();
+		return (int)n;
+	}
+
+	int getParamCount() const {
+		return t.paramCount - unusedParams;
+	}
+
+	int getStringCount() const {
+		return t.stringCount;
+	}
+
+	/** Entries get() decodes from the source file */
+	int getUndecodedCount() const {
+		int n = 0;
+		for (int i = 0; i < t.entryCount; i++) {
+			if (t.entries[i].sourceOffset >= 0) n++;
+		}
+		return n;
+	}
+
+	/** Decodes every undecoded entry, so the library no longer reads the source file. Erases those that fail. */
+	void decodeAll() {
+		std::vector<std::pair<std::string, std::string>> undecoded;
+		for (int i = 0; i < t.entryCount; i++) {
+			const Entry& e = t.entries[i];
+			if (e.sourceOffset >= 0) undecoded.push_back(std::make_pair(str(e.pluginSlug), str(e.moduleSlug)));
+		}
+		Mapping mapping;
+		for (const auto& it : undecoded) {
+			std::string pluginSlug, moduleSlug;
+			if (decodeSource(*find(it.first, it.second), pluginSlug, moduleSlug, mapping)) {
+				set(it.first, it.second, mapping);
+			}
+			else {
+				erase(it.first, it.second);
+			}
+		}
+		source.reset();
+		sourceKey = SourceKey();
+	}
+
+	/** True while the library reads its tables from an image loaded by loadImage() */
+	bool isImage() const {
+		return image != NULL;
+	}
+
+	/** Bytes held by the library, counting the image and source file it maps in full */
+	size_t getMemoryUsage() const {
+		size_t bytes = sizeof(*this);
+		if (image) bytes += image->size();
+		if (source) bytes += source->size();
+		bytes += chars.capacity();
+		bytes += stringOffsets.capacity() * sizeof(uint32_t);
+		bytes += stringSlots.capacity() * sizeof(int);
+		bytes += entries.capacity() * sizeof(Entry);
+		bytes += entrySlots.capacity() * sizeof(int);
+		bytes += params.capacity() * sizeof(Param);
+		return bytes;
+	}
+
+	/** Reads one module of the midiMap array of a library JSON file. Returns false if it has no slugs. */
+	static bool fromJson(json_t* entryJ, std::string& pluginSlug, std::string& moduleSlug, Mapping& mapping) {
+		const char* ps = json_string_value(json_object_get(entryJ, "ps")); // pluginSlug
+		const char* ms = json_string_value(json_object_get(entryJ, "ms")); // moduleSlug
+		if (!ps || !ms) return false;
+		pluginSlug = ps;
+		moduleSlug = ms;
+
+		mapping.reset();
+		mapping.pluginName = jsonString(json_object_get(entryJ, "pn")); // pluginName
+		mapping.moduleName = jsonString(json_object_get(entryJ, "mn")); // moduleName
+		json_t* autoMappedJ = json_object_get(entryJ, "am"); // autoMapped
+		if (autoMappedJ) {
+			mapping.autoMapped = json_boolean_value(autoMappedJ);
+		} else {
+			mapping.autoMapped = false; // default
+		}
+		json_t* paramMapJ = json_object_get(entryJ, "pm"); // paramMap
+		size_t j;
+		json_t* paramMapJJ;
+		json_array_foreach(paramMapJ, j, paramMapJJ) {
+			MemParam p;
+			p.paramId = json_integer_value(json_object_get(paramMapJJ, "p")); // paramId
+			p.nprn = json_integer_value(json_object_get(paramMapJJ, "n")); // nprnId
+			p.nprnMode = (NPRNMODE)json_integer_value(json_object_get(paramMapJJ, "nm")); // nprnMode
+			p.label = jsonString(json_object_get(paramMapJJ, "l")); // label
+			p.midiOptions = json_integer_value(json_object_get(paramMapJJ, "o")); // midiOptions
+			json_t* slewJ = json_object_get(paramMapJJ, "s"); // slew
+			if (slewJ) p.slew = json_real_value(slewJ);
+			json_t* minJ = json_object_get(paramMapJJ, "m"); // min
+			if (minJ) p.min = json_real_value(minJ);
+			json_t* maxJ = json_object_get(paramMapJJ, "x"); // max
+			if (maxJ) p.max = json_real_value(maxJ);
+			mapping.params.push_back(p);
+		}
+		json_t* pageLabelsJ = json_object_get(entryJ, "pl");
+		if (pageLabelsJ) {
+			json_t* pageLabelJ;
+			size_t pageLabelsIndex;
+			json_array_foreach(pageLabelsJ, pageLabelsIndex, pageLabelJ) {
+				if (pageLabelsIndex >= MAX_PAGES) continue;
+				mapping.pageLabels[pageLabelsIndex] = jsonString(pageLabelJ);
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Replaces the library with the index of the library JSON file of plugin `pluginSlug` at `path`, leaving every
+	 * module undecoded until get() needs it. Returns false, leaving the library unchanged, if the file can not be
+	 * read or is not such a library.
+	 */
+	bool loadIndex(const std::string& path, const std::string& pluginSlug) {
+		SourceKey key;
+		if (!getSourceKey(path, key)) return false;
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+		if (!file->open(path) || file->size() > INT_MAX || file->size() != key.size) return false;
+
+		MappingLibrary index;
+		std::string plugin;
+		JsonScanner j(file->data(), file->size());
+		bool ok = j.object([&](const std::string& key) -> bool {
+			if (key == "plugin") return j.readString(plugin);
+			if (key != "data") return j.skip();
+			return j.object([&](const std::string& dataKey) -> bool {
+				if (dataKey != "midiMap") return j.skip();
+				return j.array([&]() -> bool {
+					std::string ps, ms, pn, mn;
+					bool am = false;
+					int begin = j.offset();
+					bool entryOk = j.object([&](const std::string& entryKey) -> bool {
+						if (entryKey == "ps") return j.readString(ps);
+						if (entryKey == "ms") return j.readString(ms);
+						if (entryKey == "pn") return j.readString(pn);
+						if (entryKey == "mn") return j.readString(mn);
+						if (entryKey == "am") return j.readBool(am);
+						return j.skip();
+					});
+					if (!entryOk) return false;
+					// Modules without slugs are skipped, as when decoding the whole file
+					if (!ps.empty() && !ms.empty()) {
+						index.addUndecoded(ps, ms, pn, mn, am, begin, j.offset() - begin);
+					}
+					return true;
+				});
+			});
+		}) && j.atEnd();
+		if (!ok || plugin != pluginSlug) return false;
+
+		index.source = file;
+		index.sourceKey = key;
+		*this = index;
+		return true;
+	}
+
+	static bool getSourceKey(const std::string& path, SourceKey& key) {
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) return false;
+		key.size = st.st_size;
+#if defined ARCH_MAC
+		key.modifiedTime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined ARCH_LIN
+		key.modifiedTime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+		key.modifiedTime = (int64_t)st.st_mtime * 1000000000;
+#endif
+		key.pathHash = fnv1aHash(path.data(), path.size());
+		return true;
+	}
+
+	/**
+	 * Writes the tables to a binary image of the library file `key` was taken from. The image is written
+	 * beside and renamed over `path`, so a library reading the old image keeps a consistent view.
+	 */
+	bool saveImage(const std::string& path, const SourceKey& key) const {
+		// Undecoded entries are byte ranges of the file version they were indexed from, so an image of any other
+		// file or version gets them decoded
+		if (getUndecodedCount() > 0 && !isSource(key)) {
+			MappingLibrary decoded(*this);
+			decoded.decodeAll();
+			return decoded.saveImage(path, key);
+		}
+		ImageHeader h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, IMAGE_MAGIC, sizeof(h.magic));
+		h.version = IMAGE_VERSION;
+		h.entrySize = sizeof(Entry);
+		h.paramSize = sizeof(Param);
+		h.sourceSize = key.size;
+		h.sourceModifiedTime = key.modifiedTime;
+		h.sourcePathHash = key.pathHash;
+		h.charCount = t.charCount;
+		h.stringCount = t.stringCount;
+		h.stringSlotCount = t.stringSlotCount;
+		h.entryCount = t.entryCount;
+		h.entrySlotCount = t.entrySlotCount;
+		h.paramCount = t.paramCount;
+		h.unusedParamCount = unusedParams;
+		h.undecodedCount = getUndecodedCount();
+
+		// Sections start on 8 byte boundaries
+		uint64_t at = sizeof(ImageHeader);
+		auto section = [&at](uint64_t bytes) {
+			uint64_t begin = at;
+			at = (at + bytes + 7) & ~(uint64_t)7;
+			return begin;
+		};
+		h.stringOffsetsAt = section((t.stringCount + 1) * sizeof(uint32_t));
+		h.stringSlotsAt = section(t.stringSlotCount * sizeof(int));
+		h.entriesAt = section(t.entryCount * sizeof(Entry));
+		h.entrySlotsAt = section(t.entrySlotCount * sizeof(int));
+		h.paramsAt = section(t.paramCount * sizeof(Param));
+		h.charsAt = section(t.charCount);
+
+		std::string tmpPath = path + ".tmp";
+		FILE* file = std::fopen(tmpPath.c_str(), "wb");
+		if (!file) return false;
+		uint64_t written = 0;
+		auto write = [&](uint64_t begin, const void* data, uint64_t bytes) {
+			static const char padding[8] = {};
+			bool ok = std::fwrite(padding, 1, begin - written, file) == begin - written;
+			ok = ok && (bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes);
+			written = begin + bytes;
+			return ok;
+		};
+		bool ok = write(0, &h, sizeof(h));
+		ok = ok && write(h.stringOffsetsAt, t.stringOffsets, (t.stringCount + 1) * sizeof(uint32_t));
+		ok = ok && write(h.stringSlotsAt, t.stringSlots, t.stringSlotCount * sizeof(int));
+		ok = ok && write(h.entriesAt, t.entries, t.entryCount * sizeof(Entry));
+		ok = ok && write(h.entrySlotsAt, t.entrySlots, t.entrySlotCount * sizeof(int));
+		ok = ok && write(h.paramsAt, t.params, t.paramCount * sizeof(Param));
+		ok = ok && write(h.charsAt, t.chars, t.charCount);
+		ok = (std::fclose(file) == 0) && ok;
+		if (!ok) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+#if defined ARCH_WIN
+		// rename() does not replace existing files on Windows
+		std::remove(path.c_str());
+#endif
+		if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Replaces the library with a binary image written by saveImage(), if the image was made from the library
+	 * file `sourcePath` at version `key`. Returns false, leaving the library unchanged, if the image is missing,
+	 * stale or damaged.
+	 */
+	bool loadImage(const std::string& path, const std::string& sourcePath, const SourceKey& key) {
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+		if (!file->open(path)) return false;
+		if (file->size() < sizeof(ImageHeader)) return false;
+		ImageHeader h;
+		std::memcpy(&h, file->data(), sizeof(h));
+		if (std::memcmp(h.magic, IMAGE_MAGIC, sizeof(h.magic)) != 0 || h.version != IMAGE_VERSION) return false;
+		if (h.entrySize != sizeof(Entry) || h.paramSize != sizeof(Param)) return false;
+		if (h.sourceSize != key.size || h.sourceModifiedTime != key.modifiedTime || h.sourcePathHash != key.pathHash) return false;
+
+		Tables v;
+		v.charCount = h.charCount;
+		v.stringCount = h.stringCount;
+		v.stringSlotCount = h.stringSlotCount;
+		v.entryCount = h.entryCount;
+		v.entrySlotCount = h.entrySlotCount;
+		v.paramCount = h.paramCount;
+		// Check the counts fit in an int, and the sections in the file
+		if ((h.charCount | h.stringCount | h.stringSlotCount | h.entryCount | h.entrySlotCount | h.paramCount) > INT_MAX) return false;
+		if (!getSection(*file, h.stringOffsetsAt, h.stringCount + 1, v.stringOffsets)) return false;
+		if (!getSection(*file, h.stringSlotsAt, h.stringSlotCount, v.stringSlots)) return false;
+		if (!getSection(*file, h.entriesAt, h.entryCount, v.entries)) return false;
+		if (!getSection(*file, h.entrySlotsAt, h.entrySlotCount, v.entrySlots)) return false;
+		if (!getSection(*file, h.paramsAt, h.paramCount, v.params)) return false;
+		if (!getSection(*file, h.charsAt, h.charCount, v.chars)) return false;
+		// The lookups index the other tables through the slot tables, so these are checked in full. Strings and
+		// param slices are checked when they are read.
+		if (!checkSlots(v.stringSlots, v.stringSlotCount, v.stringCount)) return false;
+		if (!checkSlots(v.entrySlots, v.entrySlotCount, v.entryCount)) return false;
+		if (h.unusedParamCount > h.paramCount) return false;
+		// Undecoded entries are decoded from the library file the image was made from
+		std::shared_ptr<MappedFile> sourceFile;
+		if (h.undecodedCount > 0) {
+			sourceFile = std::make_shared<MappedFile>();
+			if (!sourceFile->open(sourcePath) || sourceFile->size() != key.size) return false;
+		}
+
+		clear();
+		std::vector<char>().swap(chars);
+		std::vector<uint32_t>().swap(stringOffsets);
+		std::vector<int>().swap(stringSlots);
+		std::vector<Entry>().swap(entries);
+		std::vector<int>().swap(entrySlots);
+		std::vector<Param>().swap(params);
+		image = file;
+		source = sourceFile;
+		if (source) sourceKey = key;
+		t = v;
+		unusedParams = h.unusedParamCount;
+		return true;
+	}
+
+   private:
+	static constexpr const char* IMAGE_MAGIC = "RSBAMLIB";
+	/** Increment when the layout of the image changes */
+	static const uint32_t IMAGE_VERSION = 2;
+
+	struct ImageHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t entrySize;
+		uint32_t paramSize;
+		uint32_t sourcePathHash;
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		uint64_t charCount;
+		uint64_t stringCount;
+		uint64_t stringSlotCount;
+		uint64_t entryCount;
+		uint64_t entrySlotCount;
+		uint64_t paramCount;
+		uint64_t unusedParamCount;
+		uint64_t undecodedCount;
+		/** File offsets of the tables */
+		uint64_t stringOffsetsAt;
+		uint64_t stringSlotsAt;
+		uint64_t entriesAt;
+		uint64_t entrySlotsAt;
+		uint64_t paramsAt;
+		uint64_t charsAt;
+	};
+
+	/** The tables read by the lookups, pointing into the owned vectors or into the image */
+	struct Tables {
+		/** Characters of all strings, back to back */
+		const char* chars;
+		int charCount;
+		/** stringCount + 1 offsets into chars, string i ends where string i + 1 begins */
+		const uint32_t* stringOffsets;
+		int stringCount;
+		/** Open addressing table of string ids, -1 if empty. Size is a power of two, at most half full. */
+		const int* stringSlots;
+		int stringSlotCount;
+		const Entry* entries;
+		int entryCount;
+		/** Open addressing table of entry indexes, -1 if empty. Size is a power of two, at most half full. */
+		const int* entrySlots;
+		int entrySlotCount;
+		const Param* params;
+		int paramCount;
+	};
+
+	Tables t;
+	/** Image the tables point into, or NULL if they point into the vectors below */
+	std::shared_ptr<MappedFile> image;
+	/** Library JSON file the undecoded entries are in */
+	std::shared_ptr<MappedFile> source;
+	/** Version of the source file, all zero without one */
+	SourceKey sourceKey;
+	std::vector<char> chars;
+	std::vector<uint32_t> stringOffsets;
+	std::vector<int> stringSlots;
+	std::vector<Entry> entries;
+	std::vector<int> entrySlots;
+	std::vector<Param> params;
+	/** Params in slices no entry refers to anymore */
+	int unusedParams;
+
+	/** Points the tables at the vectors, after they were changed */
+	void refresh() {
+		if (image) return;
+		t.chars = chars.data();
+		t.charCount = (int)chars.size();
+		t.stringOffsets = stringOffsets.data();
+		t.stringCount = (int)stringOffsets.size() - 1;
+		t.stringSlots = stringSlots.data();
+		t.stringSlotCount = (int)stringSlots.size();
+		t.entries = entries.data();
+		t.entryCount = (int)entries.size();
+		t.entrySlots = entrySlots.data();
+		t.entrySlotCount = (int)entrySlots.size();
+		t.params = params.data();
+		t.paramCount = (int)params.size();
+	}
+
+	/** Copies the tables of an image into the vectors, before the library is changed */
+	void own() {
+		if (!image) return;
+		chars.assign(t.chars, t.chars + t.charCount);
+		stringOffsets.assign(t.stringOffsets, t.stringOffsets + t.stringCount + 1);
+		stringSlots.assign(t.stringSlots, t.stringSlots + t.stringSlotCount);
+		entries.assign(t.entries, t.entries + t.entryCount);
+		entrySlots.assign(t.entrySlots, t.entrySlots + t.entrySlotCount);
+		params.assign(t.params, t.params + t.paramCount);
+		image.reset();
+		refresh();
+	}
+
+	/** Characters of a string, bounds checked as they may come from a damaged image */
+	const char* getChars(int id, size_t& len) const {
+		len = 0;
+		if (id < 0 || id >= t.stringCount) return "";
+		uint32_t begin = t.stringOffsets[id];
+		uint32_t end = t.stringOffsets[id + 1];
+		if (begin > end || end > (uint32_t)t.charCount) return "";
+		len = end - begin;
+		return t.chars + begin;
+	}
+
+	int compare(int a, int b) const {
+		size_t lenA, lenB;
+		const char* sA = getChars(a, lenA);
+		const char* sB = getChars(b, lenB);
+		int c = std::memcmp(sA, sB, std::min(lenA, lenB));
+		if (c != 0) return c;
+		return lenA < lenB ? -1 : (lenA > lenB ? 1 : 0);
+	}
+
+	int findString(const std::string& s) const {
+		return t.stringSlots[findStringSlot(s)];
+	}
+
+	int findStringSlot(const std::string& s) const {
+		size_t mask = t.stringSlotCount - 1;
+		size_t i = fnv1aHash(s.data(), s.size()) & mask;
+		while (t.stringSlots[i] >= 0) {
+			size_t len;
+			const char* c = getChars(t.stringSlots[i], len);
+			if (len == s.size() && std::memcmp(c, s.data(), len) == 0) break;
+			i = (i + 1) & mask;
+		}
+		return (int)i;
+	}
+
+	/** Owned tables only */
+	int intern(const std::string& s) {
+		int i = findStringSlot(s);
+		if (stringSlots[i] >= 0) return stringSlots[i];
+		int id = (int)stringOffsets.size() - 1;
+		chars.insert(chars.end(), s.begin(), s.end());
+		stringOffsets.push_back((uint32_t)chars.size());
+		if ((id + 1) * 2 > (int)stringSlots.size()) {
+			stringSlots.assign(stringSlots.size() * 2, -1);
+			refresh();
+			for (int j = 0; j <= id; j++) {
+				stringSlots[findStringSlot(str(j))] = j;
+			}
+		}
+		else {
+			stringSlots[i] = id;
+		}
+		refresh();
+		return id;
+	}
+
+	int findEntrySlot(int pluginSlug, int moduleSlug) const {
+		size_t mask = t.entrySlotCount - 1;
+		int key[2] = {pluginSlug, moduleSlug};
+		size_t i = fnv1aHash(key, sizeof(key)) & mask;
+		while (t.entrySlots[i] >= 0) {
+			const Entry& e = t.entries[t.entrySlots[i]];
+			if (e.pluginSlug == pluginSlug && e.moduleSlug == moduleSlug) break;
+			i = (i + 1) & mask;
+		}
+		return (int)i;
+	}
+
+	bool isSource(const SourceKey& key) const {
+		return source && sourceKey.size == key.size && sourceKey.modifiedTime == key.modifiedTime && sourceKey.pathHash == key.pathHash;
+	}
+
+	Params getParams(const Entry& e) const {
+		// Clamped, as the entry may come from a damaged image
+		int begin = std::min(std::max(e.paramBegin, 0), t.paramCount);
+		int count = std::min(std::max(e.paramCount, 0), t.paramCount - begin);
+		return Params{t.params + begin, t.params + begin + count};
+	}
+
+	/** Owned tables only. Adds an entry that get() decodes from the source file. */
+	void addUndecoded(const std::string& pluginSlug, const std::string& moduleSlug, const std::string& pluginName, const std::string& moduleName, bool autoMapped, int sourceOffset, int sourceLength) {
+		Entry e;
+		e.pluginSlug = intern(pluginSlug);
+		e.moduleSlug = intern(moduleSlug);
+		e.pluginName = intern(pluginName);
+		e.moduleName = intern(moduleName);
+		e.autoMapped = autoMapped;
+		int empty = intern("");
+		for (int i = 0; i < MAX_PAGES; i++) {
+			e.pageLabels[i] = empty;
+		}
+		e.paramBegin = (int)params.size();
+		e.paramCount = 0;
+		e.sourceOffset = sourceOffset;
+		e.sourceLength = sourceLength;
+		add(e);
+	}
+
+	bool decodeSource(const Entry& e, std::string& pluginSlug, std::string& moduleSlug, Mapping& mapping) const {
+		// Checked, as the entry may come from a damaged image
+		if (!source || e.sourceLength <= 0 || (size_t)e.sourceOffset + e.sourceLength > source->size()) return false;
+		json_error_t error;
+		json_t* entryJ = json_loadb(source->data() + e.sourceOffset, e.sourceLength, 0, &error);
+		if (!entryJ) return false;
+		bool ok = fromJson(entryJ, pluginSlug, moduleSlug, mapping);
+		json_decref(entryJ);
+		// The range must still hold the module it was indexed as
+		return ok && pluginSlug == str(e.pluginSlug) && moduleSlug == str(e.moduleSlug);
+	}
+
+	static const char* jsonString(json_t* j) {
+		const char* s = json_string_value(j);
+		return s ? s : "";
+	}
+
+	/** Owned tables only. Adds an entry, replacing the one of the same module. */
+	void add(const Entry& e) {
+		if ((entries.size() + 1) * 2 > entrySlots.size()) {
+			entrySlots.assign(entrySlots.size() * 2, -1);
+			rebuildEntrySlots();
+		}
+		int slot = findEntrySlot(e.pluginSlug, e.moduleSlug);
+		if (entrySlots[slot] >= 0) {
+			Entry& old = entries[entrySlots[slot]];
+			unusedParams += old.paramCount;
+			old = e;
+		}
+		else {
+			entrySlots[slot] = (int)entries.size();
+			entries.push_back(e);
+		}
+		refresh();
+		compactIfSparse();
+	}
+
+	/** Owned tables only */
+	void rebuildEntrySlots() {
+		std::fill(entrySlots.begin(), entrySlots.end(), -1);
+		refresh();
+		for (int j = 0; j < (int)entries.size(); j++) {
+			entrySlots[findEntrySlot(entries[j].pluginSlug, entries[j].moduleSlug)] = j;
+		}
+	}
+
+	/** Owned tables only. Drops the unused slices once they take more than half of the param array. */
+	void compactIfSparse() {
+		if (unusedParams < 64 || unusedParams * 2 < (int)params.size()) return;
+		std::vector<Param> compacted;
+		compacted.reserve(params.size() - unusedParams);
+		for (Entry& e : entries) {
+			int begin = (int)compacted.size();
+			compacted.insert(compacted.end(), params.begin() + e.paramBegin, params.begin() + e.paramBegin + e.paramCount);
+			e.paramBegin = begin;
+		}
+		params.swap(compacted);
+		unusedParams = 0;
+		refresh();
+	}
+
+	/** Just enough of a JSON reader to index a library file without decoding it */
+	struct JsonScanner {
+		const char* begin;
+		const char* p;
+		const char* end;
+
+		JsonScanner(const char* data, size_t size) : begin(data), p(data), end(data + size) {}
+
+		/** Offset of the next value */
+		int offset() {
+			ws();
+			return (int)(p - begin);
+		}
+
+		void ws() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+		}
+
+		bool expect(char c) {
+			ws();
+			if (p >= end || *p != c) return false;
+			p++;
+			return true;
+		}
+
+		bool atEnd() {
+			ws();
+			return p == end;
+		}
+
+		/** Calls member(key) for each member of an object, which must read or skip the value */
+		template <typename F>
+		bool object(F member) {
+			if (!expect('{')) return false;
+			if (expect('}')) return true;
+			do {
+				std::string key;
+				if (!readString(key) || !expect(':') || !member(key)) return false;
+			} while (expect(','));
+			return expect('}');
+		}
+
+		/** Calls element() for each element of an array, which must read or skip it */
+		template <typename F>
+		bool array(F element) {
+			if (!expect('[')) return false;
+			if (expect(']')) return true;
+			do {
+				if (!element()) return false;
+			} while (expect(','));
+			return expect(']');
+		}
+
+		bool readString(std::string& s) {
+			ws();
+			if (p >= end || *p != '"') return false;
+			const char* b = p;
+			if (!skipString()) return false;
+			if (!std::memchr(b, '\\', p - b)) {
+				s.assign(b + 1, p - b - 2);
+				return true;
+			}
+			// Escapes are rare in a library, leave them to jansson
+			json_error_t error;
+			json_t* stringJ = json_loadb(b, p - b, JSON_DECODE_ANY, &error);
+			bool ok = json_is_string(stringJ);
+			if (ok) s = json_string_value(stringJ);
+			json_decref(stringJ);
+			return ok;
+		}
+
+		bool readBool(bool& b) {
+			ws();
+			b = end - p >= 4 && std::memcmp(p, "true", 4) == 0;
+			return skip();
+		}
+
+		bool skip() {
+			ws();
+			if (p >= end) return false;
+			if (*p == '"') return skipString();
+			if (*p == '{' || *p == '[') {
+				int depth = 0;
+				while (p < end) {
+					if (*p == '"') {
+						if (!skipString()) return false;
+						continue;
+					}
+					if (*p == '{' || *p == '[') depth++;
+					else if ((*p == '}' || *p == ']') && --depth == 0) {
+						p++;
+						return true;
+					}
+					p++;
+				}
+				return false;
+			}
+			// Number, true, false or null
+			const char* b = p;
+			while (p < end && !std::strchr(",:]} \t\r\n", *p)) p++;
+			return p > b;
+		}
+
+		/** At the opening quote */
+		bool skipString() {
+			for (p++; p < end; p++) {
+				if (*p == '\\') {
+					if (++p == end) break;
+				}
+				else if (*p == '"') {
+					p++;
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	template <typename T>
+	static bool getSection(const MappedFile& file, uint64_t at, uint64_t count, const T*& p) {
+		if (at % alignof(T) != 0 || at > file.size() || count > (file.size() - at) / sizeof(T)) return false;
+		p = reinterpret_cast<const T*>(file.data() + at);
+		return true;
+	}
+
+	/** A slot table must have a power of two size, at least one empty slot, and only valid indexes */
+	static bool checkSlots(const int* slots, int slotCount, int count) {
+		if (slotCount <= 0 || (slotCount & (slotCount - 1)) != 0) return false;
+		bool empty = false;
+		for (int i = 0; i < slotCount; i++) {
+			if (slots[i] < 0) empty = true;
+			else if (slots[i] >= count) return false;
+		}
+		return empty;
+	}
+};
+
+} // namespace RSBATechModules
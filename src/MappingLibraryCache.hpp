@@ -0,0 +1,154 @@
+#pragma once
+#include "plugin.hpp"
+#include "MappingLibrary.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace RSBATechModules {
+
+/*
+Mapping libraries shared by all module instances in the process.
+
+Instances using the same library file share one library, keyed by the canonical path of the file, which is
+loaded once and lives while any instance uses it. A library is never changed in place: readers take a snapshot,
+a shared_ptr to an immutable version that stays valid for as long as they hold it, and update() applies each
+change to a copy of the current version and publishes the copy in its place. Readers on any thread see either
+version whole and never block. Copying a library that reads a mapped image or library file does not copy them.
+*/
+
+struct MappingLibraryCache {
+	typedef std::shared_ptr<const MappingLibrary> Snapshot;
+
+	struct Library {
+		/** Canonical path of the library file, empty for a library of one instance */
+		const std::string path;
+
+		Library(const std::string& path) : path(path), current(std::make_shared<MappingLibrary>()) {}
+
+		/** Current version, any thread */
+		Snapshot snapshot() const {
+			return std::atomic_load(&current);
+		}
+
+		/** Applies f(MappingLibrary&) to a copy of the current version and publishes the copy. Updates are serialized. */
+		template <typename F>
+		void update(F f) {
+			std::lock_guard<std::mutex> lock(updateMutex);
+			std::shared_ptr<MappingLibrary> next = std::make_shared<MappingLibrary>(*snapshot());
+			f(*next);
+			std::atomic_store(&current, Snapshot(next));
+		}
+
+	   private:
+		friend struct MappingLibraryCache;
+		Snapshot current;
+		std::mutex updateMutex;
+		/** Version of the file the library was last loaded from */
+		MappingLibrary::SourceKey key;
+		bool keyValid = false;
+
+		void publish(Snapshot next) {
+			std::lock_guard<std::mutex> lock(updateMutex);
+			std::atomic_store(&current, next);
+		}
+	};
+
+	static MappingLibraryCache& instance() {
+		static MappingLibraryCache cache;
+		return cache;
+	}
+
+	/**
+	 * The library of the file at `path`, shared with the other instances using it. If no instance uses it yet, or
+	 * the file changed since it was loaded, load(MappingLibrary&) loads it. Returns NULL if that fails.
+	 */
+	template <typename F>
+	std::shared_ptr<Library> open(const std::string& path, F load) {
+		std::string canonicalPath = system::getCanonical(path);
+		if (canonicalPath.empty()) canonicalPath = path;
+		MappingLibrary::SourceKey key;
+		bool keyValid = MappingLibrary::getSourceKey(path, key);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		// Forget the libraries no instance uses anymore
+		for (auto it = libraries.begin(); it != libraries.end();) {
+			if (it->second.expired()) it = libraries.erase(it);
+			else it++;
+		}
+		std::shared_ptr<Library> library = libraries[canonicalPath].lock();
+		if (library && library->keyValid == keyValid && (!keyValid || (library->key.size == key.size && library->key.modifiedTime == key.modifiedTime))) {
+			return library;
+		}
+
+		std::shared_ptr<MappingLibrary> loaded = std::make_shared<MappingLibrary>();
+		if (!load(*loaded)) return NULL;
+		if (!library) {
+			library = std::make_shared<Library>(canonicalPath);
+			libraries[canonicalPath] = library;
+		}
+		library->publish(loaded);
+		library->key = key;
+		library->keyValid = keyValid;
+		return library;
+	}
+
+   private:
+	MappingLibraryCache() {}
+
+	std::mutex mutex;
+	std::map<std::string, std::weak_ptr<Library>> libraries;
+};
+
+/**
+ * The mapping library of a module instance. Shared through MappingLibraryCache while it is the library of a file,
+ * else a library of its own.
+ */
+struct SharedMappingLibrary {
+	SharedMappingLibrary() : library(std::make_shared<MappingLibraryCache::Library>("")) {}
+
+	/** Current version of the library, any thread. Hold on to it while using entries found in it. */
+	MappingLibraryCache::Snapshot get() const {
+		return std::atomic_load(&library)->snapshot();
+	}
+
+	/** Applies f(MappingLibrary&) to the library, for every instance sharing it */
+	template <typename F>
+	void update(F f) {
+		std::atomic_load(&library)->update(f);
+	}
+
+	/** Switches to the shared library of a file, see MappingLibraryCache::open(). Unchanged if it can not be loaded. */
+	template <typename F>
+	bool open(const std::string& path, F load) {
+		std::shared_ptr<MappingLibraryCache::Library> shared = MappingLibraryCache::instance().open(path, load);
+		if (!shared) return false;
+		std::atomic_store(&library, shared);
+		return true;
+	}
+
+	/** Switches to the library `other` uses, e.g. one opened off the engine thread */
+	void assign(const SharedMappingLibrary& other) {
+		std::atomic_store(&library, std::atomic_load(&other.library));
+	}
+
+	/** Stops sharing, leaving an empty library of its own */
+	void reset() {
+		std::atomic_store(&library, std::make_shared<MappingLibraryCache::Library>(""));
+	}
+
+	/** Canonical path of the library file, empty if the library is not shared */
+	std::string getPath() const {
+		return std::atomic_load(&library)->path;
+	}
+
+	/** Instances using the library, including this one */
+	long getUseCount() const {
+		return std::atomic_load(&library).use_count() - 1;
+	}
+
+   private:
+	std::shared_ptr<MappingLibraryCache::Library> library;
+};
+
+} // namespace RSBATechModules
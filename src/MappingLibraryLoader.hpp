@@ -0,0 +1,130 @@
+#pragma once
+#include "plugin.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace RSBATechModules {
+
+/*
+Loads the mapping library of a module instance on a thread of its own.
+
+dataFromJson() runs inside the engine's write-lock, where reading the library file (or writing the factory library
+back to disk) would stall the audio engine, so it only queues the load. Jobs run one at a time, and a job that has
+not started yet is replaced by the next one. A job hands its result to the module through publish(), which drops
+it if another load was queued or the load was cancelled in the meantime.
+*/
+
+struct MappingLibraryLoader {
+	/** Called on the loader thread with the generation to pass to publish() */
+	typedef std::function<void(int)> Job;
+
+	MappingLibraryLoader() {}
+	MappingLibraryLoader(const MappingLibraryLoader&) = delete;
+	MappingLibraryLoader& operator=(const MappingLibraryLoader&) = delete;
+
+	~MappingLibraryLoader() {
+		stop();
+	}
+
+	/** Any thread. Queues job, replacing the one queued before if it has not started yet. */
+	void load(Job job) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (stopping) return;
+		generation++;
+		pending = job;
+		loading = true;
+		if (!thread.joinable()) {
+			try {
+				thread = std::thread([this] { this->loaderProcess(); });
+			} catch (std::system_error& e) {
+				WARN("Mapping library loader couldn't start its thread, loading synchronously: %s", e.what());
+				runPending(lock);
+				return;
+			}
+		}
+		wakeup.notify_one();
+	}
+
+	/** Any thread. Drops the queued job, and the result of the one running. */
+	void cancel() {
+		std::lock_guard<std::mutex> lock(mutex);
+		generation++;
+		pending = nullptr;
+		loading = running;
+		done.notify_all();
+	}
+
+	/** Loader thread. Calls f() unless the job of `generation` was replaced or cancelled since it was queued. */
+	template <typename F>
+	bool publish(int generation, F f) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (generation != this->generation) return false;
+		f();
+		return true;
+	}
+
+	/** Any thread. True while a job is queued or running. */
+	bool isLoading() {
+		return loading;
+	}
+
+	/** Blocks until no job is queued or running. Not to be called from a job. */
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return !running && !pending; });
+	}
+
+	/** Drops the queued job and waits for the running one to finish */
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			generation++;
+			pending = nullptr;
+		}
+		wakeup.notify_one();
+		if (thread.joinable()) thread.join();
+	}
+
+   private:
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::condition_variable done;
+	std::thread thread;
+	Job pending;
+	int generation = 0;
+	bool running = false;
+	bool stopping = false;
+	std::atomic<bool> loading{false};
+
+	/** Runs the pending job without holding the lock */
+	void runPending(std::unique_lock<std::mutex>& lock) {
+		Job job = pending;
+		int g = generation;
+		pending = nullptr;
+		running = true;
+		lock.unlock();
+		job(g);
+		lock.lock();
+		running = false;
+		loading = bool(pending);
+		done.notify_all();
+	}
+
+	void loaderProcess() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wakeup.wait(lock, [this] { return stopping || pending; });
+			if (stopping) break;
+			runPending(lock);
+		}
+		loading = false;
+		done.notify_all();
+	}
+};
+
+} // namespace RSBATechModules
@@ -1,6 +1,8 @@
 #include "plugin.hpp"
 #include "OrestesOne.hpp"
 #include "MapModuleBase.hpp"
+#include "MappingLibraryCache.hpp"
+#include "MappingLibraryLoader.hpp"
 #include "components/MenuLabelEx.hpp"
 #include "components/SubMenuSlider.hpp"
 #include "components/MidiWidget.hpp"
@@ -30,6 +32,11 @@ struct OrestesOneOutput : midi::Output {
 };
 
 struct E1MidiOutput : OrestesOneOutput {
+    /** Capacity reserved for m; control update strings are truncated so a message never outgrows it */
+    static const size_t SYSEX_CAPACITY = 512;
+    /** Longest escaped name or display text in a control update, leaving room for the rest of the JSON */
+    static const size_t MAX_JSON_STRING_LENGTH = 200;
+
 	std::array<int, MAX_CHANNELS> lastNPRNValues{};
     midi::Message m;
 
@@ -40,7 +47,7 @@ struct E1MidiOutput : OrestesOneOutput {
 
     E1MidiOutput() {
 		reset();
-		m.bytes.reserve(512);
+		m.bytes.reserve(SYSEX_CAPACITY);
 	}
 
 	void reset() {
@@ -48,6 +55,10 @@ struct E1MidiOutput : OrestesOneOutput {
     	m.bytes.clear();
 	}
 
+    /**
+     * Updates the name and display value of an E1 control. A NULL name is left out, for protocol revision 2
+     * presets which have it from the metadata block.
+     */
     void sendE1ControlUpdate(int id, const char* name, const char* displayValue) {
         // See https://docs.electra.one/developers/midiimplementation.html#control-update
 
@@ -72,18 +83,17 @@ struct E1MidiOutput : OrestesOneOutput {
         // controlId MSB
         m.bytes.push_back(e1ControllerId >> 7);
 
-        // Build control-update-json-data
-        // {"name":name,"value":{"id":"value","text":displayValue}}
-        json_t* valueJ = json_object();
-        json_object_set_new(valueJ, "text", json_string(displayValue));
-        json_object_set_new(valueJ, "visible", json_boolean(true));
-        json_t* rootJ = json_object();
-        json_object_set_new(rootJ, "name", json_string(name));
-        json_object_set_new(rootJ, "value", valueJ);
-        char* json = json_dumps(rootJ, JSON_COMPACT | JSON_ENSURE_ASCII);
-
-        for( char* it = json; *it; ++it )
-          m.bytes.push_back((uint8_t)*it);
+        // Build control-update-json-data straight into the SysEx message
+        // {"name":name,"value":{"text":displayValue,"visible":true}}
+        if (name) {
+            pushAscii("{\"name\":");
+            pushJsonString(name);
+            pushAscii(",\"value\":{\"text\":");
+        } else {
+            pushAscii("{\"value\":{\"text\":");
+        }
+        pushJsonString(displayValue);
+        pushAscii(",\"visible\":true}}");
 
         // SysEx closing byte
         m.bytes.push_back(0xf7);
@@ -157,6 +167,56 @@ struct E1MidiOutput : OrestesOneOutput {
          sendE1ExecuteLua("endMML()");
     }
 
+    /**
+     * Replies to the E1 sync command, telling the E1 whether the range is being re-sent
+     */
+    void sendSyncAck(int seq, bool divergent) {
+        auto raw = string::f("syncAck(%d, %d)", seq, divergent ? 1 : 0);
+        sendE1ExecuteLua(raw.c_str());
+    }
+
+    /**
+     * Start of a metadata block: content hash, number of controlMeta() calls that follow and controls per page
+     */
+    void sendMetadataBegin(uint32_t hash, int count) {
+        char raw[64];
+        snprintf(raw, sizeof(raw), "moduleMeta(%u, %d, %d)", (unsigned)hash, count, (int)NPRNS_PER_PAGE);
+        sendE1ExecuteLua(raw);
+    }
+
+    /**
+     * Name and unit of a control, built straight into the SysEx message as the engine thread sends it
+     */
+    void sendMetadataControl(int nprn, const char* name, const char* unit) {
+        char number[16];
+        snprintf(number, sizeof(number), "%d", nprn);
+        beginExecuteLua();
+        pushAscii("controlMeta(");
+        pushAscii(number);
+        pushAscii(", ");
+        pushLuaString(name);
+        pushAscii(", ");
+        pushLuaString(unit);
+        pushAscii(")");
+        m.bytes.push_back(0xf7);
+        sendMessage(m);
+    }
+
+    void sendMetadataEnd(uint32_t hash) {
+        char raw[32];
+        snprintf(raw, sizeof(raw), "moduleMetaEnd(%u)", (unsigned)hash);
+        sendE1ExecuteLua(raw);
+    }
+
+    /**
+     * Replies to the protocol command with the protocol revision used from now on
+     */
+    void sendProtocolAck(int version) {
+        char raw[32];
+        snprintf(raw, sizeof(raw), "protocolAck(%d)", version);
+        sendE1ExecuteLua(raw);
+    }
+
     void sendOrestesOneVersion(std::string o1Version) {
         auto raw = string::f("o1Version(\"%s\")", o1Version.c_str());
         sendE1ExecuteLua(raw.c_str());
@@ -177,9 +237,14 @@ struct E1MidiOutput : OrestesOneOutput {
      * [8]         Value LSB (0-127)
      * [9]       0xF7 SysEx end byte
      */
-    void setPackedNPRNValue(int value, int nprn, int valueNprnIn, bool force = false) {
+    bool setPackedNPRNValue(int value, int nprn, int valueNprnIn, bool force = false) {
+		if (snapshotting) {
+			// Sent with the snapshot instead
+			lastNPRNValues[nprn] = value;
+			return true;
+		}
 		if ((value == lastNPRNValues[nprn] || value == valueNprnIn) && !force)
-			return;
+			return false;
 		lastNPRNValues[nprn] = value;
 
   		m.bytes.clear();
@@ -205,9 +270,66 @@ struct E1MidiOutput : OrestesOneOutput {
 
  		// DEBUG("Sending bytes %s", hexStr(m.bytes.data(), m.getSize()).data());
         sendMessage(m);
+        return true;
+
+    }
+
+
+    /**
+     * Starts one chunk of a module snapshot, sent on the same port as the packed NPRN values
+     *
+ 	 * Byte(s)
+     * =======
+     * [0 ]        0xF0 SysEx header byte
+     * [1-3]       0x00 0x7F 0x7F Placeholder MIDI Manufacturer Id
+     * [4]         0x02 Snapshot
+     * [5]         Chunk number (0-127)
+     * [6]         Number of chunks (1-127)
+     * [7-x]       Entries of NPRN id MSB, NPRN id LSB, value MSB, value LSB, text length (0-63) and the
+     *             display text as ASCII bytes
+     * [x+1]       0xF7 SysEx end byte
+     */
+    void beginSnapshotChunk(int chunk, int chunks) {
+        m.bytes.clear();
+        m.bytes.push_back(0xF0);
+        m.bytes.push_back(0x00);
+        m.bytes.push_back(0x7F);
+        m.bytes.push_back(0x7F);
+        m.bytes.push_back(0x02);
+        m.bytes.push_back(chunk & 0x7F);
+        m.bytes.push_back(chunks & 0x7F);
+    }
+
+    void pushSnapshotEntry(int nprn, int value, const char* text) {
+        m.bytes.push_back(nprn >> 7);
+        m.bytes.push_back(nprn & 0x7F);
+        m.bytes.push_back(value >> 7);
+        m.bytes.push_back(value & 0x7F);
+        size_t lengthAt = m.bytes.size();
+        m.bytes.push_back(0);
+        for (; *text; ++text) {
+            if (invalidASCIIChar(*text)) continue;
+            m.bytes.push_back(*text);
+        }
+        m.bytes[lengthAt] = m.bytes.size() - lengthAt - 1;
+    }
+
+    void endSnapshotChunk() {
+        m.bytes.push_back(0xf7);
+        sendMessage(m);
+    }
 
+    /** Bytes pushSnapshotEntry() adds for a display text */
+    static int snapshotEntrySize(const char* text) {
+        int size = 5;
+        for (; *text; ++text) {
+            if (!invalidASCIIChar(*text)) size++;
+        }
+        return size;
     }
-    
+
+    /** From a module switch until its snapshot is sent, values are only recorded, see sendSnapshot() */
+    bool snapshotting = false;
 
    /**
     * Execute a Lua command on the Electra One
@@ -216,6 +338,19 @@ struct E1MidiOutput : OrestesOneOutput {
    void sendE1ExecuteLua(const char* luaCommand) {
         // DEBUG("Execute Lua %s", luaCommand);
 
+        beginExecuteLua();
+        for( char* it = (char*)luaCommand; *it; ++it )
+                  m.bytes.push_back((uint8_t)*it);
+        // SysEx closing byte
+        m.bytes.push_back(0xf7);
+
+        // DEBUG("Sending bytes %s", hexStr(m.bytes.data(), m.getSize()).data());
+        sendMessage(m);
+
+
+   }
+
+    void beginExecuteLua() {
         m.bytes.clear();
         // SysEx header byte
         m.bytes.push_back(0xF0);
@@ -228,16 +363,86 @@ struct E1MidiOutput : OrestesOneOutput {
         m.bytes.push_back(0x8);
         // Lua command
         m.bytes.push_back(0xD);
-        for( char* it = (char*)luaCommand; *it; ++it )
-                  m.bytes.push_back((uint8_t)*it);
-        // SysEx closing byte
-        m.bytes.push_back(0xf7);
+    }
 
-        // DEBUG("Sending bytes %s", hexStr(m.bytes.data(), m.getSize()).data());
-        sendMessage(m);
+    /**
+     * Appends s as a quoted Lua string. Like stripUnicode(), non-ASCII bytes are dropped, and quotes and
+     * backslashes are escaped. Cut after 50 characters to keep the Lua command short.
+     */
+    void pushLuaString(const char* s) {
+        m.bytes.push_back('"');
+        int length = 0;
+        for (; *s && length < 50; ++s) {
+            unsigned char c = *s;
+            if (invalidASCIIChar(c) || c < 0x20) continue;
+            if (c == '"' || c == '\\') m.bytes.push_back('\\');
+            m.bytes.push_back(c);
+            length++;
+        }
+        m.bytes.push_back('"');
+    }
 
+    void pushAscii(const char* s) {
+        for (; *s; ++s)
+            m.bytes.push_back((uint8_t)*s);
+    }
 
-   }
+    void pushJsonCodeUnit(uint32_t unit) {
+        static const char hex[] = "0123456789ABCDEF";
+        m.bytes.push_back('\\');
+        m.bytes.push_back('u');
+        for (int shift = 12; shift >= 0; shift -= 4)
+            m.bytes.push_back(hex[(unit >> shift) & 0xF]);
+    }
+
+    /**
+     * Appends s as a quoted JSON string, escaped as json_dumps(JSON_ENSURE_ASCII) would so every byte fits SysEx.
+     * Invalid UTF-8 bytes are dropped, and the string is cut at a character boundary after MAX_JSON_STRING_LENGTH bytes.
+     */
+    void pushJsonString(const char* s) {
+        m.bytes.push_back('"');
+        size_t end = m.bytes.size() + MAX_JSON_STRING_LENGTH;
+        const uint8_t* p = (const uint8_t*)s;
+        while (*p) {
+            // Decode one UTF-8 sequence
+            uint32_t codepoint;
+            int length;
+            if (*p < 0x80) { codepoint = *p; length = 1; }
+            else if ((*p & 0xE0) == 0xC0) { codepoint = *p & 0x1F; length = 2; }
+            else if ((*p & 0xF0) == 0xE0) { codepoint = *p & 0x0F; length = 3; }
+            else if ((*p & 0xF8) == 0xF0) { codepoint = *p & 0x07; length = 4; }
+            else { p++; continue; }
+            int i = 1;
+            for (; i < length && (p[i] & 0xC0) == 0x80; i++)
+                codepoint = (codepoint << 6) | (p[i] & 0x3F);
+            if (i < length) { p++; continue; }
+
+            // Longest escape is a surrogate pair, 12 bytes
+            if (m.bytes.size() + 12 > end) break;
+            p += length;
+            switch (codepoint) {
+                case '"': pushAscii("\\\""); break;
+                case '\\': pushAscii("\\\\"); break;
+                case '\b': pushAscii("\\b"); break;
+                case '\f': pushAscii("\\f"); break;
+                case '\n': pushAscii("\\n"); break;
+                case '\r': pushAscii("\\r"); break;
+                case '\t': pushAscii("\\t"); break;
+                default:
+                    if (codepoint < 0x20 || (codepoint > 0x7F && codepoint < 0x10000)) {
+                        pushJsonCodeUnit(codepoint);
+                    } else if (codepoint >= 0x10000) {
+                        codepoint -= 0x10000;
+                        pushJsonCodeUnit(0xD800 | (codepoint >> 10));
+                        pushJsonCodeUnit(0xDC00 | (codepoint & 0x3FF));
+                    } else {
+                        m.bytes.push_back((uint8_t)codepoint);
+                    }
+                    break;
+            }
+        }
+        m.bytes.push_back('"');
+    }
 
     std::string hexStr(const uint8_t *data, int len)
     {
@@ -321,13 +526,16 @@ struct OrestesOneModule : Module {
 
         void setValue(int value, bool sendOnly) {
             if (nprn == -1) return;
-            module->midiOutput.setPackedNPRNValue(value, nprn, module->valuesNprn[nprn], current == -1);
+            if (module->midiOutput.setPackedNPRNValue(value, nprn, module->valuesNprn[nprn], current == -1)) {
+                module->controllerValues[nprn] = value;
+            }
             if (!sendOnly) current = value;
         }
 
         void reset() {
             nprn = -1;
             current = -1;
+            module->nprnIndexDirty = true;
         }
 
         void resetValue() {
@@ -341,6 +549,7 @@ struct OrestesOneModule : Module {
         void setNprn(int nprn) {
             this->nprn = nprn;
             current = -1;
+            module->nprnIndexDirty = true;
         }
 
         bool get14bit() {
@@ -418,6 +627,17 @@ struct OrestesOneModule : Module {
 	/** The value of each NPRN parameter, assuming use range 0 .. MAX_NPRN_ID */
     int valuesNprn[MAX_NPRN_ID+1];
     uint32_t valuesNprnTs[MAX_NPRN_ID+1];
+	/** Channels mapped to each NPRN, as lists linked through nprnChannelNext. Rebuilt when nprnIndexDirty is set. */
+	int nprnChannelHead[MAX_NPRN_ID+1];
+	int nprnChannelNext[MAX_CHANNELS];
+	bool nprnIndexDirty = true;
+	static const int DIRTY_WORDS = (MAX_CHANNELS + 63) / 64;
+	/** One bit per channel whose NPRN has received a value since the last processMappings() */
+	uint64_t dirtyChannels[DIRTY_WORDS] = {};
+	/** Last value of each NPRN sent to or received from the E1 since the last module change, -1 if none */
+	int controllerValues[MAX_NPRN_ID+1];
+	/** Set once the E1 sends a sync command, which then replaces the periodic re-send */
+	bool controllerSyncs = false;
 	
 	MIDIMODE midiMode = MIDIMODE::MIDIMODE_DEFAULT;
 
@@ -432,13 +652,47 @@ struct OrestesOneModule : Module {
 
 	/** [Stored to Json] */
 	RackParam midiParam[MAX_CHANNELS];
+	/** Control page shown by the controller (0 based), -1 if unknown. Feedback for the other pages is deferred. */
+	int visiblePage = -1;
+	/** Channels whose feedback is pending because their page is not shown */
+	bool feedbackDeferred[MAX_CHANNELS];
+	/** Feedback messages for hidden pages still allowed in the current scan */
+	int hiddenFeedbackBudget = 0;
+	/** Scan all channels on the next control tick, e.g. after a page change */
+	bool scanRequested = false;
+	/** Feedback protocol revision the E1 preset asked for with the protocol command, 1 until it does */
+	int protocolVersion = 1;
+	/** A name or unit changed since the last metadata block was sent */
+	bool metadataChanged = false;
+	/** The marker of a module switch is on its way, the metadata block waits for it */
+	bool feedbackMarkerPending = false;
+	/** Display texts of the channels, formatted by the widget */
+	FeedbackTexts<MAX_CHANNELS> feedbackTexts;
+	/** Slew filters of all midiParam channels, stepped together once per processMappings() pass */
+	ChannelBank channelBank;
+	/** Engine frame of the previous processMappings() pass */
+	int64_t lastMappingsFrame = -1;
 	/** [Stored to Json] */
 	bool midiResendPeriodically;
 	dsp::ClockDivider midiResendDivider;
 
 	dsp::ClockDivider processDivider;
-	/** [Stored to Json] */
-	int processDivision;
+	/** [Stored to Json] Milliseconds between the scans for parameter changes made in Rack */
+	int processInterval;
+	/** [Stored to Json] Scan fast while controls are in use and back off when idle, instead of processInterval */
+	bool processAdaptive;
+	/** [Stored to Json] Shortest and longest scan interval of the adaptive mode, in milliseconds */
+	int processIntervalMin;
+	int processIntervalMax;
+	/** Scan interval in effect */
+	int processIntervalCurrent;
+	/** A mapped parameter changed or received a value since the last scan */
+	bool processActivity = false;
+	/** Set by the widget while one of the mapped parameters is dragged with the mouse */
+	bool paramDragged = false;
+	/** Samples per control tick, and samples counted since the last tick */
+	int controlFrames = 1;
+	int controlCounter = 0;
 	dsp::ClockDivider indicatorDivider;
 
     /** [Stored to Json] */
@@ -447,14 +701,21 @@ struct OrestesOneModule : Module {
 	// MEM-
 	// Pointer of the MEM's attribute
 	int64_t expMemModuleId = -1;
+	/** Duration of the last module switch in µs (-1 before the first), and the param handle updates it took */
+	int64_t lastSwitchUs = -1;
+	int lastSwitchHandleUpdates = 0;
 
 	/** [Stored to JSON] */
 	std::string midiMapLibraryFilename;
 	/** [Stored to JSON] */
 	bool autosaveMappingLibrary = true;
 
-	/** Internal module midiMap. Not saved to module Json. */
-	std::map<std::pair<std::string, std::string>, MemModule*> midiMap;
+	/** Internal module midiMap, shared with the other instances using the same library file. Not saved to module Json. */
+	SharedMappingLibrary midiMap;
+	/** Reused by expMemApply() and the preset import, UI thread */
+	MappingLibrary::Mapping loadedMapping;
+	/** Loads the library of dataFromJson() off the engine thread */
+	MappingLibraryLoader libraryLoader;
 
 	/** [Stored to JSON] 
 	 * Stores rack-level mapping e.g. for Patchmaster mappings
@@ -470,20 +731,26 @@ struct OrestesOneModule : Module {
 		configParam<BufferedTriggerParamQuantity>(PARAM_NEXT, 0.f, 1.f, 0.f, "Scan for next module mapping");
 		configParam<BufferedTriggerParamQuantity>(PARAM_APPLY, 0.f, 1.f, 0.f, "Apply mapping");
 
+		channelBank.setChannels(MAX_CHANNELS);
 		for (int id = 0; id < MAX_CHANNELS; id++) {
 			paramHandles[id].color = mappingIndicatorColor;
 			APP->engine->addParamHandle(&paramHandles[id]);
+			midiParam[id].setBank(&channelBank, id);
 			midiParam[id].setLimits(0, 16383, -1);
 			nprns[id].module = this;
 			nprns[id].id = id;
 		}
-		indicatorDivider.setDivision(2048);
-		midiResendDivider.setDivision(APP->engine->getSampleRate() / 2);
+		// All dividers count control ticks, i.e. milliseconds
+		indicatorDivider.setDivision(46);
+		midiResendDivider.setDivision(CONTROL_RATE / 2);
+		onSampleRateChange();
 		onReset();
 		e1MappedModuleList.reserve(INITIAL_MAPPED_MODULE_LIST_SIZE);
 	}
 
 	~OrestesOneModule() {
+		// The loader thread publishes to midiMap
+		libraryLoader.stop();
 		for (int id = 0; id < MAX_CHANNELS; id++) {
 			APP->engine->removeParamHandle(&paramHandles[id]);
 		}
@@ -500,10 +767,14 @@ struct OrestesOneModule : Module {
 		for (int i = 0; i <= MAX_NPRN_ID; i++) {
 		    valuesNprn[i] = -1;
 		    valuesNprnTs[i] = 0;
+		    controllerValues[i] = -1;
 		}
+		controllerSyncs = false;
+		visiblePage = -1;
 		for (int i = 0; i < MAX_CHANNELS; i++) {
 			lastValueIn[i] = -1;
 			lastValueOut[i] = -1;
+			feedbackDeferred[i] = false;
 			nprns[i].nprnMode = NPRNMODE::DIRECT;
 			textLabel[i] = "";
 			midiOptions[i] = 0;
@@ -522,9 +793,10 @@ struct OrestesOneModule : Module {
 		midiIgnoreDevices = false;
 		midiResendPeriodically = false;
 		midiResendDivider.reset();
-		processDivision = 4098;
-		processDivider.setDivision(processDivision);
-		processDivider.reset();
+		processAdaptive = false;
+		processIntervalMin = 10;
+		processIntervalMax = 372;
+		setProcessInterval(93);
 		overlayEnabled = true;
 		clearMapsOnLoad = false;
 		
@@ -543,45 +815,68 @@ struct OrestesOneModule : Module {
 	}
 
 	void resetMap() {
-		for (auto it : midiMap) {
-			delete it.second;
-		}
-		midiMap.clear();
+		libraryLoader.cancel();
+		midiMap.reset();
+	}
+
+	/** Waits for a library still loading, so changes apply to it rather than being replaced by it. UI thread. */
+	void waitForMappingLibrary() {
+		libraryLoader.wait();
 	}
 
 	void onSampleRateChange() override {
-		midiResendDivider.setDivision(APP->engine->getSampleRate() / 2);
+		controlFrames = std::max(1, int(std::round(APP->engine->getSampleRate() / CONTROL_RATE)));
+		controlCounter = 0;
 	}
 
+	/**
+	 * Queues the parameter name and display value of a channel to be sent to the E1. The widget formats them,
+	 * see formatFeedbackText(), and processFeedbackTexts() sends them.
+	 */
     void sendE1Feedback(int id) {
+       feedbackTexts.request(id);
+    }
 
-       if (id >= mapLen) return;
-       // Update E1 control with mapped parameter name and value
-       if (paramHandles[id].moduleId < 0) return;
+    /** UI thread, called from the widget's step() */
+    void formatE1Feedback() {
+       feedbackTexts.format([this](FeedbackTexts<MAX_CHANNELS>::Text& t) { return formatFeedbackText(t); });
+    }
+
+    /** UI thread. Fills in the parameter name and display value of channel t.id, returns false if it has none. */
+    bool formatFeedbackText(FeedbackTexts<MAX_CHANNELS>::Text& t) {
+       int id = t.id;
+       if (id >= mapLen) return false;
+       if (paramHandles[id].moduleId < 0) return false;
 
        ModuleWidget* mw = APP->scene->rack->getModule(paramHandles[id].moduleId);
-       if (!mw) return;
+       if (!mw) return false;
 
        Module* m = mw->getModule();
-       if (!m) return;
+       if (!m) return false;
        //idx of parameter in target module
        int paramId = paramHandles[id].paramId;
-       if (paramId >= (int)m->params.size()) return;
+       if (paramId >= (int)m->params.size()) return false;
 
        ParamQuantity* paramQuantity = m->paramQuantities[paramId];
-       std::stringstream ss;
-       ss << paramQuantity->getDisplayValueString() << " " << paramQuantity->getUnit();
        std::string paramName;
        if (textLabel[id].empty()) {
        		paramName = paramQuantity->getLabel();
        } else {
        		paramName = textLabel[id];
        }
-       midiCtrlOutput.sendE1ControlUpdate(nprns[id].getNprn(), paramName.c_str(), ss.str().c_str());
+       t.set(paramName.c_str(), paramQuantity->getDisplayValueString().c_str(), paramQuantity->getUnit().c_str());
+       return true;
     }
 
 
 	void process(const ProcessArgs &args) override {
+		// The audio-rate path is only this counter, all work happens once per control tick
+		if (++controlCounter < controlFrames) return;
+		controlCounter = 0;
+		processControl(args);
+	}
+
+	void processControl(const ProcessArgs &args) {
 		ts++;
 
 		// Aquire new MIDI messages from the queue
@@ -594,7 +889,7 @@ struct OrestesOneModule : Module {
 
 		// Handle indicators - blinking
 		if (indicatorDivider.process()) {
-			float t = indicatorDivider.getDivision() * args.sampleTime;
+			float t = indicatorDivider.getDivision() * (1.f / CONTROL_RATE);
 			for (int i = 0; i < mapLen; i++) {
 				paramHandles[i].color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : mappingIndicatorColor;
 				if (paramHandles[i].moduleId >= 0) {
@@ -603,7 +898,7 @@ struct OrestesOneModule : Module {
 			}
 		}
 
-		if (e1ProcessResendMIDIFeedback || (midiResendPeriodically && midiResendDivider.process())) {
+		if (e1ProcessResendMIDIFeedback || (midiResendPeriodically && !controllerSyncs && midiResendDivider.process())) {
 			midiResendFeedback();
 		}
 
@@ -611,177 +906,289 @@ struct OrestesOneModule : Module {
         // step channels for parameter changes made manually at a lower frequency . Notice
         // that midi allows about 1000 messages per second, so checking for changes more often
         // won't lead to higher precision on midi output.
-        bool stepParameterChange = processDivider.process();
+        bool stepParameterChange = processDivider.process() || scanRequested;
+        scanRequested = false;
+        if (processAdaptive && (midiReceived || paramDragged)) {
+            processActivity = true;
+            // Don't wait for the end of a long idle interval to pick up the pace
+            if (processIntervalCurrent > processIntervalMin) {
+                setProcessIntervalCurrent(processIntervalMin);
+                stepParameterChange = true;
+            }
+        }
         if (stepParameterChange || midiReceived) {
-            processMappings(args.sampleTime, stepParameterChange, midiReceived);
+            processMappings(args.sampleTime, stepParameterChange, midiReceived, args.frame);
             processE1Commands();
         }
+        if (stepParameterChange && processAdaptive) adaptProcessInterval();
+
+        // Send the display texts the widget has formatted since the last tick
+        if (!feedbackTexts.empty()) {
+            processFeedbackTexts();
+        }
 
 	}
 
-	void processMappings(float sampleTime, bool stepParameterChange, bool midiReceived) {
-		float st = sampleTime * float(processDivision);
+	void processMappings(float sampleTime, bool stepParameterChange, bool midiReceived, int64_t frame) {
+		float st = float(processIntervalCurrent) / CONTROL_RATE;
 
-		for (int id = 0; id < mapLen; id++) {
+		if (nprnIndexDirty) rebuildNprnIndex();
+		if (stepParameterChange) {
+			// Periodic scan of all channels, also picks up parameter changes made in Rack
+			hiddenFeedbackBudget = HIDDEN_FEEDBACK_PER_SCAN;
+			for (int id = 0; id < mapLen; id++) {
+				processMapping(id, st, stepParameterChange);
+			}
+			std::fill_n(dirtyChannels, DIRTY_WORDS, 0);
+		} else {
+			// Only the channels whose NPRN has received a new value
+			for (int w = 0; w < DIRTY_WORDS; w++) {
+				uint64_t bits = dirtyChannels[w];
+				dirtyChannels[w] = 0;
+				while (bits) {
+					int id = (w << 6) + __builtin_ctzll(bits);
+					bits &= bits - 1;
+					if (id < mapLen) processMapping(id, st, stepParameterChange);
+				}
+			}
+		}
+
+		// Step the slew of all channels by the time since the previous pass, once processMapping() has set the
+		// new targets
+		float dt = lastMappingsFrame >= 0 && frame > lastMappingsFrame ? sampleTime * float(frame - lastMappingsFrame) : st;
+		lastMappingsFrame = frame;
+		processSlew(dt);
+
+		// Send end of mapping message, when switching between saved module mappings
+		// NB: Module parameters may get processed in multiple process() calls, so we need to wait until all the module parameters
+		// have been send to E1 before sending the final endChangeE1Module command to the E1. Their display texts are
+		// formatted by the widget, so the message is sent when the marker queued behind them comes back.
+        if (sendE1EndMessage == 1) {
+          // The metadata block sent with the marker lists every mapped channel, also those on hidden pages
+          if (protocolVersion >= 2) requestAllFeedbackTexts();
+          feedbackTexts.requestMarker();
+          feedbackMarkerPending = true;
+          sendE1EndMessage = 0;
+        }
+	}
+
+	bool isNprnVisible(int nprn) {
+		if (visiblePage < 0) return true;
+		int page = nprn / NPRNS_PER_PAGE;
+		return page == visiblePage || page >= MAX_PAGES;
+	}
+
+	/** Page shown by the controller, 1 to MAX_PAGES, or 0 if it shows all of them */
+	bool setVisiblePage(int page) {
+		if (page < 0 || page > MAX_PAGES) return false;
+		visiblePage = page - 1;
+		// Catch up on the changes deferred for the page now shown
+		scanRequested = true;
+		return true;
+	}
+
+	void rebuildNprnIndex() {
+		nprnIndexDirty = false;
+		std::fill_n(nprnChannelHead, MAX_NPRN_ID + 1, -1);
+		for (int id = MAX_CHANNELS - 1; id >= 0; id--) {
 			int nprn = nprns[id].getNprn();
-			if (nprn < 0)
-				continue;
+			if (nprn < 0 || nprn > MAX_NPRN_ID) continue;
+			nprnChannelNext[id] = nprnChannelHead[nprn];
+			nprnChannelHead[nprn] = id;
+		}
+	}
 
-			// Get Module
+	/** Queues the channels mapped to an NPRN for the next processMappings() pass */
+	void markNprnDirty(int nprn) {
+		if (nprn < 0 || nprn > MAX_NPRN_ID) return;
+		if (nprnIndexDirty) rebuildNprnIndex();
+		for (int id = nprnChannelHead[nprn]; id >= 0; id = nprnChannelNext[id]) {
+			dirtyChannels[id >> 6] |= (uint64_t)1 << (id & 63);
+		}
+	}
+
+	/**
+	 * Steps the slew filters of all channels and applies their output, also on the channels processMapping() did
+	 * not visit in this pass
+	 */
+	void processSlew(float dt) {
+		channelBank.process(dt, mapLen);
+		if (midiMode != MIDIMODE::MIDIMODE_DEFAULT) return;
+		for (int id = 0; id < mapLen; id++) {
+			if (channelBank.lambda[id] == 0.f || nprns[id].getNprn() < 0) continue;
 			Module* module = paramHandles[id].module;
-			if (!module)
-				continue;
+			if (module && midiParam[id].hasTarget(module, paramHandles[id].paramId)) midiParam[id].processSlew();
+		}
+	}
+
+	/**
+	 * Steps one mapping channel: applies a new NPRN value to its parameter and sends feedback for parameter changes
+	 */
+	void processMapping(int id, float st, bool stepParameterChange) {
+		int nprn = nprns[id].getNprn();
+		if (nprn < 0)
+			return;
 
-			// Get ParamQuantity
-			int paramId = paramHandles[id].paramId;
+		// Get Module
+		Module* module = paramHandles[id].module;
+		if (!module)
+			return;
+
+		// Resolve the ParamQuantity only when the ParamHandle points somewhere new, midiParam[id] keeps the
+		// Param pointer and range for the following passes
+		int paramId = paramHandles[id].paramId;
+		if (!midiParam[id].hasTarget(module, paramId)) {
 			ParamQuantity* paramQuantity = module->paramQuantities[paramId];
 			if (!paramQuantity)
-				continue;
+				return;
 
 			if (!paramQuantity->isBounded())
-				continue;
+				return;
 
-			switch (midiMode) {
-				case MIDIMODE::MIDIMODE_DEFAULT: {
-					midiParam[id].paramQuantity = paramQuantity;
-					int t = -1;
+			midiParam[id].setTarget(module, paramId, paramQuantity);
+		}
+		ParamQuantity* paramQuantity = midiParam[id].paramQuantity;
+
+		switch (midiMode) {
+			case MIDIMODE::MIDIMODE_DEFAULT: {
+				int t = -1;
 
  
-                    if (!e1ProcessResetParameter && nprn >= 0 && nprns[id].process()) {
-					    // Check if NPRN value has been set and changed
-						switch (nprns[id].nprnMode) {
-							case NPRNMODE::DIRECT:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									lastValueIn[id] = nprns[id].getValue();
+                if (!e1ProcessResetParameter && nprn >= 0 && nprns[id].process()) {
+				    // Check if NPRN value has been set and changed
+					switch (nprns[id].nprnMode) {
+						case NPRNMODE::DIRECT:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								lastValueIn[id] = nprns[id].getValue();
+								t = nprns[id].getValue();
+							}
+							break;
+						case NPRNMODE::PICKUP1:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								if (midiParam[id].isNear(lastValueIn[id])) {
+									midiParam[id].resetFilter();
 									t = nprns[id].getValue();
 								}
-								break;
-							case NPRNMODE::PICKUP1:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									if (midiParam[id].isNear(lastValueIn[id])) {
-										midiParam[id].resetFilter();
-										t = nprns[id].getValue();
-									}
-									lastValueIn[id] = nprns[id].getValue();
-								}
-								break;
-							case NPRNMODE::PICKUP2:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									if (midiParam[id].isNear(lastValueIn[id], nprns[id].getValue())) {
-										midiParam[id].resetFilter();
-										t = nprns[id].getValue();
-									}
-									lastValueIn[id] = nprns[id].getValue();
-								}
-								break;
-							case NPRNMODE::TOGGLE:
-								if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-									t = midiParam[id].getLimitMax();
-									lastValueIn[id] = -2;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
-									t = midiParam[id].getLimitMax();
-									lastValueIn[id] = -3;
-								}
-								else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
-									t = midiParam[id].getLimitMin();
-									lastValueIn[id] = -4;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
-									t = midiParam[id].getLimitMin();
-									lastValueIn[id] = -1;
-								}
-								break;
-							case NPRNMODE::TOGGLE_VALUE:
-								if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								lastValueIn[id] = nprns[id].getValue();
+							}
+							break;
+						case NPRNMODE::PICKUP2:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								if (midiParam[id].isNear(lastValueIn[id], nprns[id].getValue())) {
+									midiParam[id].resetFilter();
 									t = nprns[id].getValue();
-									lastValueIn[id] = -2;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
-									t = midiParam[id].getValue();
-									lastValueIn[id] = -3;
 								}
-								else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
-									t = midiParam[id].getLimitMin();
-									lastValueIn[id] = -4;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
-									t = midiParam[id].getLimitMin();
-									lastValueIn[id] = -1;
-								}
-								break;
-						}
+								lastValueIn[id] = nprns[id].getValue();
+							}
+							break;
+						case NPRNMODE::TOGGLE:
+							if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = midiParam[id].getLimitMax();
+								lastValueIn[id] = -2;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = midiParam[id].getLimitMax();
+								lastValueIn[id] = -3;
+							}
+							else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
+						case NPRNMODE::TOGGLE_VALUE:
+							if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = nprns[id].getValue();
+								lastValueIn[id] = -2;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = midiParam[id].getValue();
+								lastValueIn[id] = -3;
+							}
+							else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = midiParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
 					}
+				}
 
-			        int v;
+		        int v;
 
-					// Set a new value for the mapped parameter
-					if (e1ProcessResetParameter && nprn == e1ProcessResetParameterNPRN) {
-                        midiParam[id].setValueToDefault();
-                        e1ProcessResetParameterNPRN = -1;
-                        lastValueOut[id] = -1;
-                        nprns[id].resetValue(); // Forces NPRN adapter to emit NPRM message out
+				// Set a new value for the mapped parameter
+				if (e1ProcessResetParameter && nprn == e1ProcessResetParameterNPRN) {
+                    midiParam[id].setValueToDefault();
+                    e1ProcessResetParameterNPRN = -1;
+                    lastValueOut[id] = -1;
+                    nprns[id].resetValue(); // Forces NPRN adapter to emit NPRM message out
 
-                    } else if (t >= 0) {
-						midiParam[id].setValue(t);
-						if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
-					}
+                } else if (t >= 0) {
+					midiParam[id].setValue(t);
+					if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
+				}
 
-					// Apply value on the mapped parameter (respecting slew and scale)
-					midiParam[id].process(st);
-
-					// Retrieve the current value of the parameter (ignoring slew and scale)
-					v = midiParam[id].getValue();
-
-					// Midi feedback
-					if (lastValueOut[id] != v) {
-
-						if (!e1ProcessResetParameter && nprn >= 0 && nprns[id].nprnMode == NPRNMODE::DIRECT)
-                        							lastValueIn[id] = v;
-				        
-
-						// Send enriched parameter feedback to E1
-						// But only at the "processDivider" rate to control data rate sent to E1.
-						// This means the displayed parameter values on E1 will lag the actual parameter value whilst
-						// the parameter is being chnaged (either from E1 or from the VCVRack GUI).
-						// Users can adjust the Oresets-One "Precision" to balance that lag with stability of E1 (reducing data traffic)
-						if (stepParameterChange) {
-							// Send manually altered parameter change out to MIDI
-						    nprns[id].setValue(v, lastValueIn[id] < 0);
-							lastValueOut[id] = v;
-
-							// DEBUG("Sending MIDI feedback for %d, value %d", id, v);
-							sendE1Feedback(id);
-                        	e1ProcessResetParameter = false;
-                       		 // If we are broadcasting parameter updates when switching modules,
-                       		 // record that we have now sent this parameter
-                        	if (sendE1EndMessage > 0) sendE1EndMessage--;
-                        }
+				// Apply value on the mapped parameter (respecting slew and scale)
+				midiParam[id].process(st);
+
+				// Retrieve the current value of the parameter (ignoring slew and scale)
+				v = midiParam[id].getValue();
+
+				// Midi feedback
+				if (lastValueOut[id] != v) {
+
+					if (!e1ProcessResetParameter && nprn >= 0 && nprns[id].nprnMode == NPRNMODE::DIRECT)
+                    							lastValueIn[id] = v;
+			        
+
+					// Send enriched parameter feedback to E1
+					// But only at the "processDivider" rate to control data rate sent to E1.
+					// This means the displayed parameter values on E1 will lag the actual parameter value whilst
+					// the parameter is being chnaged (either from E1 or from the VCVRack GUI).
+					// Users can adjust the Oresets-One "Precision" to balance that lag with stability of E1 (reducing data traffic)
+					if (stepParameterChange && !isNprnVisible(nprn) && hiddenFeedbackBudget <= 0 && !midiOutput.snapshotting) {
+						// Not on the page the controller shows, leave the change pending for a later scan
+						if (!feedbackDeferred[id]) {
+							feedbackDeferred[id] = true;
+							if (sendE1EndMessage > 0) sendE1EndMessage--;
+						}
 					}
-				} break;
+					else if (stepParameterChange) {
+						// Send manually altered parameter change out to MIDI
+						if (!isNprnVisible(nprn) && !midiOutput.snapshotting) hiddenFeedbackBudget--;
+					    nprns[id].setValue(v, lastValueIn[id] < 0);
+						lastValueOut[id] = v;
+						processActivity = true;
+
+						// DEBUG("Sending MIDI feedback for %d, value %d", id, v);
+						sendE1Feedback(id);
+                    	e1ProcessResetParameter = false;
+                   		 // If we are broadcasting parameter updates when switching modules,
+                   		 // record that we have now sent this parameter
+                    	if (sendE1EndMessage > 0 && !feedbackDeferred[id]) sendE1EndMessage--;
+                    	feedbackDeferred[id] = false;
+                    }
+				}
+			} break;
 
-				case MIDIMODE::MIDIMODE_LOCATE: {
-					bool indicate = false;
-					if ((nprn >= 0 && nprns[id].getValue() >= 0) && lastValueInIndicate[id] != nprns[id].getValue()) {
-						lastValueInIndicate[id] = nprns[id].getValue();
-						indicate = true;
-					}
-					if (indicate) {
-						ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
-						paramHandles[id].indicate(mw);
-					}
-				} break;
-			}
+			case MIDIMODE::MIDIMODE_LOCATE: {
+				bool indicate = false;
+				if ((nprn >= 0 && nprns[id].getValue() >= 0) && lastValueInIndicate[id] != nprns[id].getValue()) {
+					lastValueInIndicate[id] = nprns[id].getValue();
+					indicate = true;
+				}
+				if (indicate) {
+					ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
+					paramHandles[id].indicate(mw);
+				}
+			} break;
 		}
-
-		// Send end of mapping message, when switching between saved module mappings
-		// NB: Module parameters may get processed in multiple process() calls, so we need to wait until all the module parameters
-		// have been send to E1 before sending the final endChangeE1Module command to the E1.
-        if (sendE1EndMessage == 1) {
-          // Send end module mapping message to E1
-          endChangeE1Module();
-          sendE1EndMessage = 0;
-        }
 	}
 
 	bool midiProcessMessage(midi::Message msg) {
@@ -923,6 +1330,31 @@ struct OrestesOneModule : Module {
      * Command: Version Poll
      * [5]			0x09 Version Poll
      * 
+     * Command: Sync (re-send the mapped parameters of an NPRN range only if the E1's view has drifted)
+     * [5]			0x0A Sync
+     * [6]			Sequence number (0-127), echoed in the syncAck() reply
+     * [7]			First NPRN id MSB (0-127)
+     * [8]			First NPRN id LSB (0-127)
+     * [9]			Last NPRN id MSB (0-127)
+     * [10]			Last NPRN id LSB (0-127)
+     * [11-14]		Checksum of the range as computed by nprnSyncChecksum(), 24 bits as 7-bit groups, most significant first
+     * 
+     * Command: Page (control page shown by the E1, feedback for the other pages is sent lazily)
+     * [5]			0x0B Page
+     * [6]			Page number (1-6), or 0 if all pages are shown
+     * 
+     * Command: Protocol (selects the feedback protocol revision, replied with protocolAck(revision used))
+     * [5]			0x0C Protocol
+     * [6]			Revision, 1 (default), 2 or 3
+     * 
+     * Revision 1 sends the name and the display value with unit in every control update. Revision 2 sends only
+     * the display value, and after each module switch, before endChangeE1Module(), a metadata block of Lua calls:
+     * moduleMeta(hash, number of entries, controls per page), controlMeta(nprn, name, unit) per mapped control
+     * and moduleMetaEnd(hash). The block is sent again if a label is edited. A preset that has the layout of a
+     * hash cached may ignore the entries. Revision 3 is revision 2 where the values and display texts of a module
+     * switch are not sent one by one but together as snapshot chunks, see E1MidiOutput::beginSnapshotChunk(),
+     * between the metadata block and endChangeE1Module().
+     * 
      */
     bool parseE1SysEx(midi::Message msg) {
         if (msg.getSize() < 7)
@@ -956,6 +1388,8 @@ struct OrestesOneModule : Module {
                 bool midiReceived = valuesNprn[nprn] != value;
                 valuesNprn[nprn] = value;
                 valuesNprnTs[nprn] = ts;
+                controllerValues[nprn] = value;
+                markNprnDirty(nprn);
                 return midiReceived;
         	}
             // Command
@@ -996,6 +1430,7 @@ struct OrestesOneModule : Module {
                     case 0x05: {
                         e1ProcessResetParameter = true;
                         e1ProcessResetParameterNPRN = ((int) msg.bytes.at(6) << 7) + ((int) msg.bytes.at(7));
+                        markNprnDirty(e1ProcessResetParameterNPRN);
 
                         // DEBUG("Received an E1 Reset Parameter Command for NPRN %d", e1ProcessResetParameterNPRN);
                         return true;
@@ -1024,6 +1459,27 @@ struct OrestesOneModule : Module {
 	            		e1VersionPoll = true;
                         return true;
 	            	}
+	            	// Sync
+	            	case 0x0A: {
+	            		if (msg.getSize() < 16) return false;
+	            		int seq = msg.bytes.at(6);
+	            		int firstNprn = (msg.bytes.at(7) << 7) + msg.bytes.at(8);
+	            		int lastNprn = (msg.bytes.at(9) << 7) + msg.bytes.at(10);
+	            		int checksum = (msg.bytes.at(11) << 21) + (msg.bytes.at(12) << 14) + (msg.bytes.at(13) << 7) + msg.bytes.at(14);
+	            		return processSync(seq, firstNprn, lastNprn, checksum);
+	            	}
+	            	// Page
+	            	case 0x0B: {
+	            		if (msg.getSize() < 8) return false;
+	            		// DEBUG("Received an E1 Page Command");
+	            		return setVisiblePage(msg.bytes.at(6));
+	            	}
+	            	// Protocol
+	            	case 0x0C: {
+	            		if (msg.getSize() < 8) return false;
+	            		// DEBUG("Received an E1 Protocol Command");
+	            		return setProtocolVersion(msg.bytes.at(6));
+	            	}
                     default: {
                         return false;
                     }
@@ -1113,6 +1569,8 @@ struct OrestesOneModule : Module {
                     bool midiReceived = valuesNprn[nprn] != value;
                     valuesNprn[nprn] = value;
                     valuesNprnTs[nprn] = ts;
+                    controllerValues[nprn] = value;
+                    markNprnDirty(nprn);
                     return midiReceived;
                 }
 
@@ -1129,18 +1587,180 @@ struct OrestesOneModule : Module {
 		return false;
 	}
 
+	/**
+	 * Handles the E1 sync command: compares the E1's checksum of an NPRN range with our own and, if they differ,
+	 * re-sends the value and display text of every mapped control in that range.
+	 * Returns true if the range was out of sync.
+	 */
+	bool processSync(int seq, int firstNprn, int lastNprn, int checksum) {
+		firstNprn = clamp(firstNprn, 0, MAX_NPRN_ID);
+		lastNprn = clamp(lastNprn, 0, MAX_NPRN_ID);
+		controllerSyncs = true;
+		bool divergent = nprnSyncChecksum(controllerValues, firstNprn, lastNprn) != checksum;
+		if (divergent) {
+			for (int id = 0; id < mapLen; id++) {
+				int nprn = nprns[id].getNprn();
+				if (nprn < firstNprn || nprn > lastNprn) continue;
+				lastValueOut[id] = -1;
+				nprns[id].resetValue();
+				feedbackTexts.clearSent(id);
+			}
+		}
+		midiCtrlOutput.sendSyncAck(seq, divergent);
+		return divergent;
+	}
+
 	void midiResendFeedback() {
 		for (int i = 0; i < MAX_CHANNELS; i++) {
 			lastValueOut[i] = -1;
 			nprns[i].resetValue();
 		}
+		// The display texts too, even those unchanged
+		feedbackTexts.clearSent();
 	}
 
 	void changeE1Module(const std::string moduleName, float moduleY, float moduleX, int maxNprnId, const std::array<std::string, MAX_PAGES>& pageLabels) {
 	    // DEBUG("changeE1Module to %s", moduleName);
+	    // The E1 starts the new module with no known values, and so do we
+	    std::fill_n(controllerValues, MAX_NPRN_ID + 1, -1);
+	    // Resend all display texts for the new module, even those unchanged
+	    feedbackTexts.clearSent();
 	    midiCtrlOutput.changeE1Module(moduleName, moduleY, moduleX, maxNprnId, pageLabels);
 	}
 
+	/**
+	 * Sends the display texts formatted by the widget. Revision 1 presets get name and value with unit in every
+	 * control update. Revision 2 presets get only the value, names and units go to the metadata block, which is
+	 * sent when the texts of a module switch are complete or after a label was edited.
+	 */
+	void processFeedbackTexts() {
+		// Kept queued while no output device is selected, so no text is recorded as sent that the E1 never got
+		if (midiCtrlOutput.getDeviceId() < 0) return;
+		feedbackTexts.receive([this](const FeedbackTexts<MAX_CHANNELS>::Text& t, bool metaChanged, bool valueChanged) -> bool {
+			if (t.id < 0) {
+				// Marker behind the texts of a module switch
+				feedbackMarkerPending = false;
+				if (protocolVersion >= 2 && metadataChanged) sendMetadata();
+				if (midiOutput.snapshotting) sendSnapshot();
+				endChangeE1Module();
+				return true;
+			}
+			int nprn = nprns[t.id].getNprn();
+			if (nprn < 0) return true;
+			if (midiOutput.snapshotting) {
+				// Sent with the snapshot
+				if (metaChanged) metadataChanged = true;
+			}
+			else if (protocolVersion >= 2) {
+				if (metaChanged) metadataChanged = true;
+				if (valueChanged) midiCtrlOutput.sendE1ControlUpdate(nprn, NULL, t.value);
+			}
+			else {
+				char displayValue[FeedbackTexts<MAX_CHANNELS>::TEXT_LENGTH + FeedbackTexts<MAX_CHANNELS>::UNIT_LENGTH];
+				snprintf(displayValue, sizeof(displayValue), "%s %s", t.value, t.unit);
+				midiCtrlOutput.sendE1ControlUpdate(nprn, t.name, displayValue);
+			}
+			return true;
+		});
+		if (metadataChanged && !feedbackMarkerPending && sendE1EndMessage == 0) sendMetadata();
+	}
+
+	void requestAllFeedbackTexts() {
+		for (int id = 0; id < mapLen; id++) {
+			if (nprns[id].getNprn() >= 0) feedbackTexts.request(id);
+		}
+	}
+
+	/**
+	 * Hash of the metadata block, over controls per page and the NPRN, name and unit of each entry.
+	 * The preset treats it as an opaque key. Also returns the number of entries.
+	 */
+	uint32_t metadataHash(int& count) {
+		uint8_t perPage = NPRNS_PER_PAGE;
+		uint32_t h = fnv1aHash(&perPage, 1);
+		count = 0;
+		for (int id = 0; id < mapLen; id++) {
+			int nprn = nprns[id].getNprn();
+			const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+			if (nprn < 0 || !t) continue;
+			uint8_t nprnBytes[2] = {(uint8_t)(nprn >> 8), (uint8_t)nprn};
+			h = fnv1aHash(nprnBytes, 2, h);
+			h = fnv1aHash(t->name, std::strlen(t->name) + 1, h);
+			h = fnv1aHash(t->unit, std::strlen(t->unit) + 1, h);
+			count++;
+		}
+		return h;
+	}
+
+	/** Sends the names and units of all mapped controls as one metadata block of Lua commands */
+	void sendMetadata() {
+		metadataChanged = false;
+		int count;
+		uint32_t hash = metadataHash(count);
+		midiCtrlOutput.sendMetadataBegin(hash, count);
+		for (int id = 0; id < mapLen; id++) {
+			int nprn = nprns[id].getNprn();
+			const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+			if (nprn < 0 || !t) continue;
+			midiCtrlOutput.sendMetadataControl(nprn, t->name, t->unit);
+		}
+		midiCtrlOutput.sendMetadataEnd(hash);
+	}
+
+	/**
+	 * Sends the value and display text of every mapped control, as recorded since the module switch, in as
+	 * few snapshot SysEx chunks as SYSEX_CAPACITY allows. See E1MidiOutput::beginSnapshotChunk() for the format.
+	 */
+	void sendSnapshot() {
+		midiOutput.snapshotting = false;
+		// Room left by the chunk header and end byte
+		int limit = (int)E1MidiOutput::SYSEX_CAPACITY - 8;
+		int chunks = 0;
+		// The first pass counts the chunks, the second sends them
+		for (int pass = 0; pass < 2; pass++) {
+			int chunk = 0;
+			int size = 0;
+			if (pass == 1) midiOutput.beginSnapshotChunk(chunk, chunks);
+			for (int id = 0; id < mapLen; id++) {
+				int nprn = nprns[id].getNprn();
+				if (nprn < 0 || controllerValues[nprn] < 0) continue;
+				const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+				const char* text = t ? t->value : "";
+				int entrySize = E1MidiOutput::snapshotEntrySize(text);
+				if (size > 0 && size + entrySize > limit) {
+					chunk++;
+					size = 0;
+					if (pass == 1) {
+						midiOutput.endSnapshotChunk();
+						midiOutput.beginSnapshotChunk(chunk, chunks);
+					}
+				}
+				if (pass == 1) midiOutput.pushSnapshotEntry(nprn, controllerValues[nprn], text);
+				size += entrySize;
+			}
+			if (pass == 1) midiOutput.endSnapshotChunk();
+			chunks = chunk + 1;
+		}
+	}
+
+	/** Feedback protocol revision asked for by the E1 preset, replied with the revision used */
+	bool setProtocolVersion(int version) {
+		protocolVersion = clamp(version, 1, (int)PROTOCOL_VERSION);
+		metadataChanged = false;
+		midiOutput.snapshotting = false;
+		// Send all names and values again in the form of the new revision
+		midiResendFeedback();
+		if (protocolVersion >= 2) requestAllFeedbackTexts();
+		midiCtrlOutput.sendProtocolAck(protocolVersion);
+		return true;
+	}
+
+	/** UI thread. Sets the label of a channel and sends it to the E1. */
+	void setTextLabel(int id, std::string label) {
+		textLabel[id] = label;
+		feedbackTexts.request(id);
+	}
+
 	void endChangeE1Module() {
 	    // DEBUG("endChangeE1Module");
 	    midiCtrlOutput.endChangeE1Module();
@@ -1178,6 +1798,40 @@ struct OrestesOneModule : Module {
         }
 	}
 
+	/**
+	 * Clears all mappings like clearMaps_WithLock(), then binds channels 0 .. count - 1 to the parameters in
+	 * moduleIds / paramIds. Rack gives plugins no way to hold the engine write lock over several handle
+	 * updates, so rather than a clear and a learnParam() per channel (two locks each) this updates only the
+	 * handles whose target changes, with one updateParamHandle() each. Returns the number of updates.
+	 */
+	int rebindMaps(const int64_t* moduleIds, const int* paramIds, int count) {
+		learningId = -1;
+		int updates = 0;
+		for (int id = 0; id < MAX_CHANNELS; id++) {
+			int64_t moduleId = id < count ? moduleIds[id] : -1;
+			int paramId = id < count ? paramIds[id] : 0;
+			nprns[id].reset();
+			textLabel[id] = "";
+			midiOptions[id] = 0;
+			midiParam[id].reset();
+			// Read from the handle itself, an earlier update may have taken its parameter away
+			if (paramHandles[id].moduleId != moduleId || (moduleId >= 0 && paramHandles[id].paramId != paramId)) {
+				APP->engine->updateParamHandle(&paramHandles[id], moduleId, paramId, true);
+				updates++;
+			}
+			refreshParamHandleText(id);
+		}
+		mapLen = 1;
+		expMemModuleId = -1;
+		if (count > 0) learnedParam = true;
+
+		for (int i = 0; i < MAX_PAGES; i++) {
+            pageLabels[i].clear();
+        }
+		updateMapLen();
+		return updates;
+	}
+
 	void clearMaps_NoLock() {
 		learningId = -1;
 		for (int id = 0; id < MAX_CHANNELS; id++) {
@@ -1332,6 +1986,7 @@ struct OrestesOneModule : Module {
      * Optionally skips modules which already have a mapping definition loaded into Orestes-One midiMap
      */
     void autoMapAllModules(bool skipPremappedModules) {
+		waitForMappingLibrary();
 
     	// Get snapshot of current state
 		json_t* currentStateJ = toJson();
@@ -1394,7 +2049,8 @@ struct OrestesOneModule : Module {
 	}
 
 	void expMemSave(std::string pluginSlug, std::string moduleSlug, bool autoMapped) {
-		MemModule* m = new MemModule;
+		waitForMappingLibrary();
+		MappingLibrary::Mapping m;
 		Module* module = NULL;
 		bool hasParameters = false;
 		for (size_t i = 0; i < MAX_CHANNELS; i++) {
@@ -1402,43 +2058,39 @@ struct OrestesOneModule : Module {
 			if (paramHandles[i].module->model->plugin->slug != pluginSlug && paramHandles[i].module->model->slug == moduleSlug) continue;
 			hasParameters = true;
 			module = paramHandles[i].module;
-			MemParam* p = new MemParam;
-			p->paramId = paramHandles[i].paramId;
-			p->nprn = nprns[i].getNprn();
-			p->nprnMode = nprns[i].nprnMode;
-			p->label = textLabel[i];
-			p->midiOptions = midiOptions[i];
-			p->slew = midiParam[i].getSlew();
-			p->min = midiParam[i].getMin();
-			p->max = midiParam[i].getMax();
-			m->paramMap.push_back(p);
+			MemParam p;
+			p.paramId = paramHandles[i].paramId;
+			p.nprn = nprns[i].getNprn();
+			p.nprnMode = nprns[i].nprnMode;
+			p.label = textLabel[i];
+			p.midiOptions = midiOptions[i];
+			p.slew = midiParam[i].getSlew();
+			p.min = midiParam[i].getMin();
+			p.max = midiParam[i].getMax();
+			m.params.push_back(p);
 		}
 
 		if (!hasParameters) return; // No mapped parameters, so do not add to map
 
-		m->pluginName = module->model->plugin->name;
-		m->moduleName = module->model->name;
-		m->autoMapped = autoMapped; // Manually saving module map, so assume is no longer considered auto-mapped
+		m.pluginName = module->model->plugin->name;
+		m.moduleName = module->model->name;
+		m.autoMapped = autoMapped; // Manually saving module map, so assume is no longer considered auto-mapped
         for (size_t i = 0; i < MAX_PAGES; i++) {
-            m->pageLabels[i] = pageLabels[i];   
+            m.pageLabels[i] = pageLabels[i];   
         }
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it != midiMap.end()) {
-			delete it->second;
-		}
-
-		(midiMap)[p] = m;
+		midiMap.update([&](MappingLibrary& lib) {
+			lib.set(pluginSlug, moduleSlug, m);
+		});
 	}
 
 	void expMemDelete(std::string pluginSlug, std::string moduleSlug) {
+		waitForMappingLibrary();
 		json_t* currentStateJ = toJson();
 
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it != midiMap.end()) {
-			delete it->second;
-			midiMap.erase(p);
+		if (midiMap.get()->find(pluginSlug, moduleSlug)) {
+			midiMap.update([&](MappingLibrary& lib) {
+				lib.erase(pluginSlug, moduleSlug);
+			});
 
 			// history::ModuleChange
 			history::ModuleChange* h = new history::ModuleChange;
@@ -1452,18 +2104,12 @@ struct OrestesOneModule : Module {
 
 	/* Delete all mapped modules belonging to same plugin, add to undo history */
 	void expMemPluginDelete(std::string pluginSlug) {
+		waitForMappingLibrary();
 		json_t* currentStateJ = toJson();
 
-		// From: https://stackoverflow.com/a/4600592
-		auto itr = midiMap.begin();
-		while (itr != midiMap.end()) {
-		    if (itr->first.first == pluginSlug) {
-		    	delete itr->second;
-		       	itr = midiMap.erase(itr);
-		    } else {
-		       ++itr;
-		    }
-		}
+		midiMap.update([&](MappingLibrary& lib) {
+			lib.erasePlugin(pluginSlug);
+		});
 
 		// history::ModuleChange
 		history::ModuleChange* h = new history::ModuleChange;
@@ -1477,9 +2123,12 @@ struct OrestesOneModule : Module {
 
     /* Delete all mapped modules, add to undo history */
     void expMemPluginDeleteAll() {
+        waitForMappingLibrary();
         json_t* currentStateJ = toJson();
 
-        resetMap();
+        midiMap.update([](MappingLibrary& lib) {
+            lib.clear();
+        });
 
         // history::ModuleChange
         history::ModuleChange* h = new history::ModuleChange;
@@ -1519,37 +2168,60 @@ struct OrestesOneModule : Module {
 
 	void expMemApply(Module* m, math::Vec pos = Vec(0,0)) {
 		if (!m) return;
-		auto p = std::pair<std::string, std::string>(m->model->plugin->slug, m->model->slug);
-		auto it = midiMap.find(p);
-		if (it == midiMap.end()) return;
-		MemModule* map = it->second;
+		if (libraryLoader.isLoading()) {
+			WARN("Mapping library is still loading, skipping the mapping of %s %s", m->model->plugin->slug.c_str(), m->model->slug.c_str());
+			return;
+		}
+		MappingLibraryCache::Snapshot lib = midiMap.get();
+		const MappingLibrary::Entry* entry = lib->find(m->model->plugin->slug, m->model->slug);
+		if (!entry) return;
+		// Decodes the mapping on its first use if the library was only indexed
+		MappingLibrary::Mapping& map = loadedMapping;
+		if (!lib->get(*entry, map)) {
+			WARN("Could not decode the mapping of %s %s", m->model->plugin->slug.c_str(), m->model->slug.c_str());
+			return;
+		}
+		const std::vector<MemParam>& params = map.params;
+		int64_t switchStart = system::getNanoseconds();
 
         // Send message to E1 to prep for new mappings before new values sent
         int maxNprnId = 0;
-        for (MemParam* it : map->paramMap) {
-        	if (it->nprn > maxNprnId) {
-        		maxNprnId = it->nprn;
+        for (const MemParam& it : params) {
+        	if (it.nprn > maxNprnId) {
+        		maxNprnId = it.nprn;
         	}
         }
-		changeE1Module(m->model->getFullName(), pos.y, pos.x, maxNprnId, map->pageLabels);
-
-		clearMaps_WithLock();
+		changeE1Module(m->model->getFullName(), pos.y, pos.x, maxNprnId, map.pageLabels);
+
+		// Bind the param handles of the new mapping up front, in as few engine locks as possible
+		int64_t moduleIds[MAX_CHANNELS];
+		int paramIds[MAX_CHANNELS];
+		int count = 0;
+		for (const MemParam& it : params) {
+			if (count >= MAX_CHANNELS) break;
+			moduleIds[count] = m->id;
+			paramIds[count] = it.paramId;
+			count++;
+		}
+		lastSwitchHandleUpdates = rebindMaps(moduleIds, paramIds, count);
 		midiOutput.reset();
 		midiCtrlOutput.reset();
 
 		expMemModuleId = m->id;
 		int i = 0;
 		sendE1EndMessage = 1;
-		for (MemParam* it : map->paramMap) {
-			learnParam(i, m->id, it->paramId);
-			nprns[i].setNprn(it->nprn);
-			nprns[i].nprnMode = it->nprnMode;
+		std::fill_n(feedbackDeferred, MAX_CHANNELS, false);
+		// Revision 3 sends the values and texts of the new mapping together in one snapshot
+		midiOutput.snapshotting = protocolVersion >= 3;
+		for (const MemParam& it : params) {
+			nprns[i].setNprn(it.nprn);
+			nprns[i].nprnMode = it.nprnMode;
 			nprns[i].set14bit(true);
-			textLabel[i] = it->label;
-			midiOptions[i] = it->midiOptions;
-			midiParam[i].setSlew(it->slew);
-			midiParam[i].setMin(it->min);
-			midiParam[i].setMax(it->max);
+			textLabel[i] = it.label;
+			midiOptions[i] = it.midiOptions;
+			midiParam[i].setSlew(it.slew);
+			midiParam[i].setMin(it.min);
+			midiParam[i].setMax(it.max);
 			// Force next processMappings() call to process all mappings after module controls have been switched
 			lastValueOut[i] = -1;
 
@@ -1560,16 +2232,22 @@ struct OrestesOneModule : Module {
 			i++;
 		}
         for (int i = 0; i < MAX_PAGES; i++) {
-            pageLabels[i] = map->pageLabels[i];
+            pageLabels[i] = map.pageLabels[i];
         }
 
 		updateMapLen();
+		// Don't wait for the next scan to collect the new mapping
+		scanRequested = true;
+
+		lastSwitchUs = (system::getNanoseconds() - switchStart) / 1000;
+		DEBUG("Module switch took %lld µs, %d param handle updates", (long long)lastSwitchUs, lastSwitchHandleUpdates);
 
 	}
 
 	void expMemApplyRackMapping() {
 
 		if (rackMapping.paramMap.empty()) return;
+		int64_t switchStart = system::getNanoseconds();
 
 		// Send message to E1 to prep for new rack mappings before new values sent
         int maxNprnId = 0;
@@ -1579,15 +2257,26 @@ struct OrestesOneModule : Module {
         	}
         }
 		changeE1Module("Rack Mapping", 0, 0, maxNprnId, rackMapping.pageLabels);
-		clearMaps_WithLock();
+		int64_t moduleIds[MAX_CHANNELS];
+		int paramIds[MAX_CHANNELS];
+		int count = 0;
+		for (MemParam* it : rackMapping.paramMap) {
+			if (count >= MAX_CHANNELS) break;
+			moduleIds[count] = it->moduleId;
+			paramIds[count] = it->paramId;
+			count++;
+		}
+		lastSwitchHandleUpdates = rebindMaps(moduleIds, paramIds, count);
 		midiOutput.reset();
 		midiCtrlOutput.reset();
 		expMemModuleId = -1;
 
 		int i = 0;
 		sendE1EndMessage = 1;
+		std::fill_n(feedbackDeferred, MAX_CHANNELS, false);
+		// Revision 3 sends the values and texts of the new mapping together in one snapshot
+		midiOutput.snapshotting = protocolVersion >= 3;
 		for (MemParam* it : rackMapping.paramMap) {
-			learnParam(i,it->moduleId, it->paramId);
 			nprns[i].setNprn(it->nprn);
 			nprns[i].nprnMode = it->nprnMode;
 			nprns[i].set14bit(true);
@@ -1610,6 +2299,11 @@ struct OrestesOneModule : Module {
         }
 
 		updateMapLen();
+		// Don't wait for the next scan to collect the new mapping
+		scanRequested = true;
+
+		lastSwitchUs = (system::getNanoseconds() - switchStart) / 1000;
+		DEBUG("Module switch took %lld µs, %d param handle updates", (long long)lastSwitchUs, lastSwitchHandleUpdates);
 
 	}
 
@@ -1646,16 +2340,8 @@ struct OrestesOneModule : Module {
 		json_object_set_new(rootJ, "plugin", json_string(this->model->plugin->slug.c_str()));
 		json_t* dataJ = json_object();
 
-		// Get map of all mapped modules for this plugin
-		std::map<std::pair<std::string, std::string>, MemModule*> pluginMap;
-
-		pluginMap.clear();
-		for (auto it : midiMap) {
-			if (it.first.first == pluginSlug)
-				pluginMap[it.first] = it.second;
-		}
-
-		json_t* midiMapJ = midiMapToJsonArray(pluginMap);
+		// Only the mapped modules of this plugin
+		json_t* midiMapJ = midiMapToJsonArray(*midiMap.get(), pluginSlug);
 
 		json_object_set_new(dataJ, "midiMap", midiMapJ);
 		json_object_set_new(rootJ, "data", dataJ);
@@ -1683,10 +2369,9 @@ struct OrestesOneModule : Module {
 		return findModuleInMidiMap(m->model->plugin->slug, m->model->slug);
 	}
 	bool findModuleInMidiMap(std::string pluginSlug, std::string moduleSlug) {
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it == midiMap.end()) return false;
-		return true;
+		// Nothing counts as mapped until the library has loaded
+		if (libraryLoader.isLoading()) return false;
+		return midiMap.get()->find(pluginSlug, moduleSlug) != NULL;
 	}
 
 	/**
@@ -1694,6 +2379,7 @@ struct OrestesOneModule : Module {
 	 * overwriting existing file contents
 	 */ 
 	void expMemSaveLibrary(bool force = false) {
+		waitForMappingLibrary();
 
 		if (midiMapLibraryFilename.empty()) return;
 		if (!force && !autosaveMappingLibrary) return;
@@ -1719,7 +2405,10 @@ struct OrestesOneModule : Module {
 		json_object_set_new(rootJ, "textScrolling", json_boolean(textScrolling));
 		json_object_set_new(rootJ, "mappingIndicatorHidden", json_boolean(mappingIndicatorHidden));
 		json_object_set_new(rootJ, "locked", json_boolean(locked));
-		json_object_set_new(rootJ, "processDivision", json_integer(processDivision));
+		json_object_set_new(rootJ, "processInterval", json_integer(processInterval));
+		json_object_set_new(rootJ, "processAdaptive", json_boolean(processAdaptive));
+		json_object_set_new(rootJ, "processIntervalMin", json_integer(processIntervalMin));
+		json_object_set_new(rootJ, "processIntervalMax", json_integer(processIntervalMax));
 		json_object_set_new(rootJ, "overlayEnabled", json_boolean(overlayEnabled));
 		json_object_set_new(rootJ, "clearMapsOnLoad", json_boolean(clearMapsOnLoad));
 		json_object_set_new(rootJ, "scrollToModule", json_boolean(scrollToModule));
@@ -1790,33 +2479,42 @@ struct OrestesOneModule : Module {
 		return rootJ;
 	}
 
-	json_t* midiMapToJsonArray(std::map<std::pair<std::string, std::string>, MemModule*>& aMidiMap) {
+	/**
+	 * Mapping library as JSON, ordered by plugin and module slug. Only the modules of pluginSlug, unless it is empty.
+	 * Any thread.
+	 */
+	json_t* midiMapToJsonArray(const MappingLibrary& lib, const std::string& pluginSlug = "") {
 		json_t* midiMapJ = json_array();
-		for (auto it : aMidiMap) {
+		MappingLibrary::Mapping m;
+		for (const MappingLibrary::Entry* a : lib.sorted()) {
+			if (!pluginSlug.empty() && lib.str(a->pluginSlug) != pluginSlug) continue;
+			if (!lib.get(*a, m)) {
+				WARN("Could not decode the mapping of %s %s, skipping", lib.str(a->pluginSlug).c_str(), lib.str(a->moduleSlug).c_str());
+				continue;
+			}
 			json_t* midiMapJJ = json_object();
-			json_object_set_new(midiMapJJ, "ps", json_string(it.first.first.c_str())); // pluginSlug
-			json_object_set_new(midiMapJJ, "ms", json_string(it.first.second.c_str())); // moduleSlug
-			auto a = it.second;
-			json_object_set_new(midiMapJJ, "am", json_boolean(a->autoMapped)); // autoMapped
-			json_object_set_new(midiMapJJ, "pn", json_string(a->pluginName.c_str())); // pluginName
-			json_object_set_new(midiMapJJ, "mn", json_string(a->moduleName.c_str())); // moduleName
+			json_object_set_new(midiMapJJ, "ps", json_string(lib.str(a->pluginSlug).c_str())); // pluginSlug
+			json_object_set_new(midiMapJJ, "ms", json_string(lib.str(a->moduleSlug).c_str())); // moduleSlug
+			json_object_set_new(midiMapJJ, "am", json_boolean(m.autoMapped)); // autoMapped
+			json_object_set_new(midiMapJJ, "pn", json_string(m.pluginName.c_str())); // pluginName
+			json_object_set_new(midiMapJJ, "mn", json_string(m.moduleName.c_str())); // moduleName
 			json_t* paramMapJ = json_array();
-			for (auto p : a->paramMap) {
+			for (const MemParam& p : m.params) {
 				json_t* paramMapJJ = json_object();
-				json_object_set_new(paramMapJJ, "p", json_integer(p->paramId));
-				json_object_set_new(paramMapJJ, "n", json_integer(p->nprn));
-				json_object_set_new(paramMapJJ, "nm", json_integer((int)p->nprnMode));
-				json_object_set_new(paramMapJJ, "l", json_string(p->label.c_str()));
-				json_object_set_new(paramMapJJ, "o", json_integer(p->midiOptions));
-				json_object_set_new(paramMapJJ, "s", json_real(p->slew));
-				json_object_set_new(paramMapJJ, "m", json_real(p->min));
-				json_object_set_new(paramMapJJ, "x", json_real(p->max));
+				json_object_set_new(paramMapJJ, "p", json_integer(p.paramId));
+				json_object_set_new(paramMapJJ, "n", json_integer(p.nprn));
+				json_object_set_new(paramMapJJ, "nm", json_integer((int)p.nprnMode));
+				json_object_set_new(paramMapJJ, "l", json_string(p.label.c_str()));
+				json_object_set_new(paramMapJJ, "o", json_integer(p.midiOptions));
+				json_object_set_new(paramMapJJ, "s", json_real(p.slew));
+				json_object_set_new(paramMapJJ, "m", json_real(p.min));
+				json_object_set_new(paramMapJJ, "x", json_real(p.max));
 				json_array_append_new(paramMapJ, paramMapJJ);
 			}
 			json_object_set_new(midiMapJJ, "pm", paramMapJ); // paramMap
             json_t* pageLabelsJ = json_array();
             for (int page = 0; page < MAX_PAGES; page++) {
-                json_array_append_new(pageLabelsJ, json_string(a->pageLabels[page].c_str()));
+                json_array_append_new(pageLabelsJ, json_string(m.pageLabels[page].c_str()));
             }
             json_object_set_new(midiMapJJ, "pl", pageLabelsJ);
 			json_array_append_new(midiMapJ, midiMapJJ);
@@ -1834,8 +2532,16 @@ struct OrestesOneModule : Module {
 		if (mappingIndicatorHiddenJ) mappingIndicatorHidden = json_boolean_value(mappingIndicatorHiddenJ);
 		json_t* lockedJ = json_object_get(rootJ, "locked");
 		if (lockedJ) locked = json_boolean_value(lockedJ);
+		json_t* processAdaptiveJ = json_object_get(rootJ, "processAdaptive");
+		if (processAdaptiveJ) processAdaptive = json_boolean_value(processAdaptiveJ);
+		json_t* processIntervalMinJ = json_object_get(rootJ, "processIntervalMin");
+		json_t* processIntervalMaxJ = json_object_get(rootJ, "processIntervalMax");
+		if (processIntervalMinJ && processIntervalMaxJ) setProcessIntervalLimits(json_integer_value(processIntervalMinJ), json_integer_value(processIntervalMaxJ));
+		json_t* processIntervalJ = json_object_get(rootJ, "processInterval");
+		if (processIntervalJ) setProcessInterval(json_integer_value(processIntervalJ));
+		// Older patches store the interval in samples at 44.1 kHz
 		json_t* processDivisionJ = json_object_get(rootJ, "processDivision");
-		if (processDivisionJ) setProcessDivision(json_integer_value(processDivisionJ));
+		if (!processIntervalJ && processDivisionJ) setProcessInterval((int)std::lround(json_integer_value(processDivisionJ) * 1000.0 / 44100.0));
 		json_t* overlayEnabledJ = json_object_get(rootJ, "overlayEnabled");
 		if (overlayEnabledJ) overlayEnabled = json_boolean_value(overlayEnabledJ);
 		json_t* clearMapsOnLoadJ = json_object_get(rootJ, "clearMapsOnLoad");
@@ -1975,58 +2681,58 @@ struct OrestesOneModule : Module {
 		json_t* autosaveMappingLibraryJ = json_object_get(rootJ, "autosaveMidiMapLibrary");
 		if (autosaveMappingLibraryJ) autosaveMappingLibrary = json_boolean_value(autosaveMappingLibraryJ);
 
-		// Try to read and load the  module midimap library from the saved file location from the saved JSON
-		bool midiMapLoaded = false;
+		// Load the module midimap library from the saved file location from the saved JSON, off the engine thread
 		json_t* midiMapLibraryFilenameJ = json_object_get(rootJ, "midiMapLibraryFilename");
 		if (midiMapLibraryFilenameJ) {
-
 			midiMapLibraryFilename = json_string_value(midiMapLibraryFilenameJ);
-
-			// Load library data from file into json
-			if (!midiMapLibraryFilename.empty()) {
-				if (readMappingLibraryFile(midiMapLibraryFilename)) midiMapLoaded = true;
-			} else {
-				midiMapLoaded = loadDefaultMappingLibraryFromPresetFolder();
-			}
-		}
-
-		// No loaded midimap library file either from Pylades state or loaded preset
-		// So try and load default factory mapping library
-		if (!midiMapLoaded) {
-			createMappingLibraryFromFactory();
-		}
-			
-	}
-
-	bool loadDefaultMappingLibraryFromPresetFolder() {
-		// If there is a default library file in the user presets, load that anyway
-		std::string userPresetPath = this->model->getUserPresetDirectory();
-		midiMapLibraryFilename = system::join(userPresetPath, DEFAULT_LIBRARY_FILENAME);
-
-		if (system::exists(midiMapLibraryFilename)) {
-			return readMappingLibraryFile(midiMapLibraryFilename);
+			loadMappingLibrary();
+		} else {
+			// No library file in the saved state, so load the factory mapping library
+			loadMappingLibrary(false);
 		}
-		return false;	
-
 	}
 
-	void createMappingLibraryFromFactory() {
-
-		if (loadMidiMapFromFactoryLibraryFile()) {
-			// factory library loaded OK, now save copy of factory midimap to user preset folder if there is not already one in there
-
-			std::string userPresetPath = this->model->getUserPresetDirectory();
-			std::string defaultMidiMapLibraryFilename = system::join(userPresetPath, DEFAULT_LIBRARY_FILENAME);
-			INFO("Factory library loaded, saving to preset library %s", defaultMidiMapLibraryFilename.c_str() );
-			if (!system::exists(midiMapLibraryFilename)) {
-				system::createDirectories(userPresetPath); // NB: no-op if model preset folder already exists
-				midiMapLibraryFilename = defaultMidiMapLibraryFilename;
-				saveMappingLibraryFile(defaultMidiMapLibraryFilename);
-			} 
-		}
+	/**
+	 * Loads the library file midiMapLibraryFilename, or the default library file in the user presets if it is empty.
+	 * Falls back to the factory library, which is saved as the default library file if there is no library file.
+	 * The file I/O runs on the loader thread, and the module switches to the library once it is loaded.
+	 */
+	void loadMappingLibrary(bool readLibrary = true) {
+		std::string defaultLibraryFilename = system::join(this->model->getUserPresetDirectory(), DEFAULT_LIBRARY_FILENAME);
+		if (midiMapLibraryFilename.empty()) midiMapLibraryFilename = defaultLibraryFilename;
+		readLibrary = readLibrary && system::exists(midiMapLibraryFilename);
+		bool saveFactory = !system::exists(midiMapLibraryFilename);
+		if (saveFactory) midiMapLibraryFilename = defaultLibraryFilename;
+
+		std::string filename = midiMapLibraryFilename;
+		libraryLoader.load([this, filename, readLibrary, saveFactory](int generation) {
+			int64_t loadStart = system::getNanoseconds();
+			SharedMappingLibrary loaded;
+			bool ok = readLibrary && readMappingLibraryFile(filename, loaded);
+			if (!ok && loadMidiMapFromFactoryLibraryFile(loaded)) {
+				ok = true;
+				if (saveFactory) {
+					// factory library loaded OK, now save copy of factory midimap to user preset folder
+					INFO("Factory library loaded, saving to preset library %s", filename.c_str());
+					system::createDirectories(system::getDirectory(filename)); // NB: no-op if model preset folder already exists
+					if (writeMappingLibraryFile(filename, *loaded.get())) readMappingLibraryFile(filename, loaded);
+				}
+			}
+			if (!ok) return;
+
+			bool published = libraryLoader.publish(generation, [&]() {
+				midiMap.assign(loaded);
+			});
+			double loadMs = (system::getNanoseconds() - loadStart) / 1e6;
+			if (published) {
+				INFO("Loaded mapping library %s in %.1f ms", loaded.getPath().c_str(), loadMs);
+			} else {
+				INFO("Loaded mapping library %s in %.1f ms, dropped as another load was started", loaded.getPath().c_str(), loadMs);
+			}
+		});
 	}
 
-	bool loadMidiMapFromFactoryLibraryFile() {
+	bool loadMidiMapFromFactoryLibraryFile(SharedMappingLibrary& target) {
         // Load factory default library
         // It is stored in the RSBATechModules plugin presets folder
         std::string factoryLibraryFilename = asset::plugin(this->model->plugin, system::join("presets", FACTORY_LIBRARY_FILENAME));
@@ -2036,152 +2742,60 @@ struct OrestesOneModule : Module {
 			return false;
 		}
 		
-		FILE* file = fopen(factoryLibraryFilename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load factory library file %s, skipping", factoryLibraryFilename.c_str());
-			return false;
-		}
-		DEFER({
-			fclose(file);
+		std::string pluginSlug = this->model->plugin->slug;
+		bool loaded = target.open(factoryLibraryFilename, [&](MappingLibrary& lib) {
+			return lib.loadIndex(factoryLibraryFilename, pluginSlug);
 		});
-
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		DEFER({
-			json_decref(libraryJ);
-		});
-
-		if (!libraryJ) {
-			WARN("Factory library file is not a valid JSON file. Parsing error at %s %d:%d %s, skipping", error.source, error.line, error.column, error.text);
-			return false;
-		}
-	
-		if (loadMidiMapFromLibrary(libraryJ)) {
-            INFO("Loaded factory library file %s", factoryLibraryFilename.c_str());
-			return true;
-		} else {
+		if (!loaded) {
+			WARN("Factory library file %s is not a valid mapping library file, skipping", factoryLibraryFilename.c_str());
 			return false;
 		}
-
-
+		INFO("Loaded factory library file %s", factoryLibraryFilename.c_str());
+		return true;
 	}
 
 
+	/**
+	 * Switches to the mapping library of a file, shared with the other instances using it. The file is only loaded
+	 * if no instance has it loaded yet, or it changed since.
+	 */
 	bool readMappingLibraryFile(std::string filename) {
+		waitForMappingLibrary();
+		return readMappingLibraryFile(filename, midiMap);
+	}
 
-		// DEBUG ("Reading mapping library file at %s", filename.c_str());
-		FILE* file = fopen(filename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load mapping library file %s", filename.c_str());
-			return false;
-		}
-		DEFER({
-			fclose(file);
-		});
+	/** Switches target to the mapping library of a file. Any thread. */
+	bool readMappingLibraryFile(const std::string& filename, SharedMappingLibrary& target) {
+		std::string pluginSlug = this->model->plugin->slug;
+		bool loaded = target.open(filename, [&](MappingLibrary& lib) {
+			// Map the binary image of the library if it is up to date, rather than reading the JSON
+			MappingLibrary::SourceKey key;
+			if (MappingLibrary::getSourceKey(filename, key) && lib.loadImage(filename + LIBRARY_IMAGE_EXTENSION, filename, key)) {
+				INFO("Loaded mapping library image of %s: %d modules", filename.c_str(), lib.size());
+				return true;
+			}
 
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		DEFER ({
-			json_decref(libraryJ);
+			// Index the modules of the library, each is decoded when it is first used
+			if (!lib.loadIndex(filename, pluginSlug)) return false;
+			INFO("Indexed mapping library %s: %d modules", filename.c_str(), lib.size());
+			if (!MappingLibrary::getSourceKey(filename, key) || !lib.saveImage(filename + LIBRARY_IMAGE_EXTENSION, key)) {
+				WARN("Could not write mapping library image for %s", filename.c_str());
+			}
+			return true;
 		});
-
-		if (!libraryJ) {
-			WARN("File is not a valid JSON file. Parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
+		if (!loaded) {
+			WARN("File %s is not a valid mapping library file", filename.c_str());
 			return false;
 		}
-		return loadMidiMapFromLibrary(libraryJ);
-		
-	}
-
-	/**
-	 * Replaces internal midiMap from selected mapping library file
-	 * 
-	 * Mutates the currentStateJ with the loaded midiMap list
-	 */
-	bool loadMidiMapFromLibrary(json_t* libraryJ) {
-
-        json_t* pluginJ = json_object_get(libraryJ, "plugin");
-        if (!pluginJ) return false;
-
-		std::string pluginSlug = json_string_value(pluginJ);
-
-		// Only handle midimap library JSON files created by OrestesOne
-		if (!(pluginSlug == this->model->plugin->slug))
-			return false;
-
-		// Get the midiMap in the imported library Json
-		json_t* dataJ = json_object_get(libraryJ, "data");
-		json_t* midiMapJ = json_object_get(dataJ, "midiMap");
-		
-		// Load libray file midiMap into internal midiMap state
-		midiMapJSONArrayToMidiMap(midiMapJ);
-
-		// DEBUG("Loaded midiMap with %d", (int)midiMap.size());
-
+		DEBUG("Mapping library %s is used by %ld instances", filename.c_str(), target.getUseCount());
 		return true;
 	}
 
 	/**
-	 * Replaces internal midiMap with contents of a midiMap JSON array
+	 * Writes a mapping library as a mapping library json file, and its binary image beside it so the next load
+	 * can map the image instead of parsing the file. Any thread.
 	 */
-	void midiMapJSONArrayToMidiMap(json_t* midiMapJ) {
-
-		resetMap();
-		size_t i;
-		json_t* midiMapJJ;
-		json_array_foreach(midiMapJ, i, midiMapJJ) {
-			midiMapJSONToMidiMap(midiMapJJ);
-		}
-	}
-
-	void midiMapJSONToMidiMap(json_t* midiMapJJ) {
-		std::string pluginSlug = json_string_value(json_object_get(midiMapJJ, "ps")); // pluginSlug
-		std::string moduleSlug = json_string_value(json_object_get(midiMapJJ, "ms")); // moduleSlug
-
-		MemModule* a = new MemModule;
-		a->pluginName = json_string_value(json_object_get(midiMapJJ, "pn")); // pluginName
-		a->moduleName = json_string_value(json_object_get(midiMapJJ, "mn")); // moduleName
-		json_t* autoMappedJ = json_object_get(midiMapJJ, "am"); // autoMapped
-		if (autoMappedJ) {
-			a->autoMapped = json_boolean_value(autoMappedJ);
-		} else {
-			a->autoMapped = false; // default
-		}
-		json_t* paramMapJ = json_object_get(midiMapJJ, "pm"); // paramMap
-		size_t j;
-		json_t* paramMapJJ;
-		json_array_foreach(paramMapJ, j, paramMapJJ) {
-			MemParam* p = new MemParam;
-			p->paramId = json_integer_value(json_object_get(paramMapJJ, "p")); // paramId
-			p->nprn = json_integer_value(json_object_get(paramMapJJ, "n")); // nprnId
-			p->nprnMode = (NPRNMODE)json_integer_value(json_object_get(paramMapJJ, "nm")); // nprnMode
-			p->label = json_string_value(json_object_get(paramMapJJ, "l")); // label
-			p->midiOptions = json_integer_value(json_object_get(paramMapJJ, "o")); // midiOptions
-			json_t* slewJ = json_object_get(paramMapJJ, "s"); // slew
-			if (slewJ) p->slew = json_real_value(slewJ);
-			json_t* minJ = json_object_get(paramMapJJ, "m"); // min
-			if (minJ) p->min = json_real_value(minJ);
-			json_t* maxJ = json_object_get(paramMapJJ, "x"); // max
-			if (maxJ) p->max = json_real_value(maxJ);
-			a->paramMap.push_back(p);
-
-		}
-        json_t* pageLabelsJ = json_object_get(midiMapJJ, "pl");
-        if (pageLabelsJ) {
-            json_t* pageLabelJ;
-            size_t pageLabelsIndex;
-            json_array_foreach(pageLabelsJ, pageLabelsIndex, pageLabelJ) {
-                if (pageLabelsIndex >= MAX_PAGES) continue;
-                a->pageLabels[pageLabelsIndex] = json_string_value(pageLabelJ);
-            }
-        }
-		midiMap[std::pair<std::string, std::string>(pluginSlug, moduleSlug)] = a;
-	}
-
-	/**
-	 * Co-ordinates saving internal midimap state as a mapping library json file
-	 */
-	bool saveMappingLibraryFile(std::string filename) {
+	bool writeMappingLibraryFile(const std::string& filename, const MappingLibrary& lib) {
 
 		INFO ("Saving library to %s", filename.c_str());
 		json_t* rootJ = json_object();
@@ -2191,38 +2805,93 @@ struct OrestesOneModule : Module {
 
 		json_object_set_new(rootJ, "plugin", json_string(this->model->plugin->slug.c_str()));
 		json_t* dataJ = json_object();
-		json_t* midiMapJ = midiMapToJsonArray(midiMap);
+		json_t* midiMapJ = midiMapToJsonArray(lib);
 
 		json_object_set_new(dataJ, "midiMap", midiMapJ);
 		json_object_set_new(rootJ, "data", dataJ);
 
-		// Write to json file
-		FILE* file = fopen(filename.c_str(), "w");
-		if (!file) {
-			WARN("Could not open mapping library file for writing %s", filename.c_str());
+		// Write to a json file beside it and rename that over the old one, which a loaded library may still be
+		// decoding modules from
+		std::string tmpFilename = filename + ".tmp";
+		{
+			FILE* file = fopen(tmpFilename.c_str(), "w");
+			if (!file) {
+				WARN("Could not open mapping library file for writing %s", tmpFilename.c_str());
+				return false;
+			}
+
+			// Save midimap library JSON in a relatively compact form.
+			// Assume can be expanded in text editors if anyone needs to read and edit them directly.
+			bool written = json_dumpf(rootJ, file, 0) >= 0;
+			if (fclose(file) != 0) written = false;
+			if (!written) {
+				WARN("Could not write mapping library file %s", tmpFilename.c_str());
+				std::remove(tmpFilename.c_str());
+				return false;
+			}
+		}
+#if defined ARCH_WIN
+		// rename() does not replace existing files on Windows
+		std::remove(filename.c_str());
+#endif
+		if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+			WARN("Could not replace mapping library file %s", filename.c_str());
+			std::remove(tmpFilename.c_str());
 			return false;
 		}
-		DEFER({
-			fclose(file);
-		});
 
-        // Save midimap library JSON in a relatively compact form.
-        // Assume can be expanded in text editors if anyone needs to read and edit them directly.
-		if (json_dumpf(rootJ, file, 0) < 0) {
+		// The file is closed, so the image is keyed on its final size and modification time
+		MappingLibrary::SourceKey key;
+		if (!MappingLibrary::getSourceKey(filename, key) || !lib.saveImage(filename + LIBRARY_IMAGE_EXTENSION, key)) {
+			WARN("Could not write mapping library image for %s", filename.c_str());
+		}
+		return true;
+	}
+
+	/**
+	 * Co-ordinates saving internal midimap state as a mapping library json file
+	 */
+	bool saveMappingLibraryFile(std::string filename) {
+		if (!writeMappingLibraryFile(filename, *midiMap.get())) {
 			std::string message = string::f("File could not be written to %s", filename.c_str());
 			osdialog_message(OSDIALOG_ERROR, OSDIALOG_OK, message.c_str());
 			return false;
 		}
-
+		// Share the library of the saved file from now on. The file changed, so the instances already sharing it
+		// reload it from the new file and image too.
+		readMappingLibraryFile(filename);
 		return true;
 	}
 
-	void setProcessDivision(int d) {
-		processDivision = d;
-		processDivider.setDivision(d);
+	void setProcessInterval(int ms) {
+		processInterval = std::max(1, ms);
+		setProcessIntervalCurrent(processAdaptive ? processIntervalMin : processInterval);
+	}
+
+	void setProcessAdaptive(bool adaptive) {
+		processAdaptive = adaptive;
+		setProcessInterval(processInterval);
+	}
+
+	void setProcessIntervalLimits(int min, int max) {
+		processIntervalMin = std::max(1, min);
+		processIntervalMax = std::max(processIntervalMin, max);
+		setProcessInterval(processInterval);
+	}
+
+	void setProcessIntervalCurrent(int ms) {
+		processIntervalCurrent = ms;
+		processDivider.setDivision(ms);
 		processDivider.reset();
 	}
 
+	/** Adaptive mode, after each scan: fastest rate while there is activity, else halve the rate down to the slowest */
+	void adaptProcessInterval() {
+		int ms = processActivity ? processIntervalMin : std::min(processIntervalCurrent * 2, processIntervalMax);
+		processActivity = false;
+		if (ms != processIntervalCurrent) setProcessIntervalCurrent(ms);
+	}
+
 	void setMode(MIDIMODE midiMode) {
 		if (this->midiMode == midiMode)
 			return;
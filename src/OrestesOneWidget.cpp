@@ -119,7 +119,7 @@ struct OrestesOneChoice : MapModuleChoice<MAX_CHANNELS, OrestesOneModule> {
 				int id;
 				void onSelectKey(const event::SelectKey& e) override {
 					if (e.action == GLFW_PRESS && e.key == GLFW_KEY_ENTER) {
-						module->textLabel[id] = text;
+						module->setTextLabel(id, text);
 
 						ui::MenuOverlay* overlay = getAncestorOfType<ui::MenuOverlay>();
 						overlay->requestDelete();
@@ -136,7 +136,7 @@ struct OrestesOneChoice : MapModuleChoice<MAX_CHANNELS, OrestesOneModule> {
 				OrestesOneModule* module;
 				int id;
 				void onAction(const event::Action& e) override {
-					module->textLabel[id] = "";
+					module->setTextLabel(id, "");
 				}
 			};
 
@@ -213,7 +213,7 @@ struct MemDisplay : OrestesLedDisplay {
 	void step() override {
 		OrestesLedDisplay::step();
 		if (!module) return;
-		text = string::f("%i", (int)module->midiMap.size());
+		text = string::f("%i", (int)module->midiMap.get()->size());
 	}
 };
 
@@ -299,6 +299,15 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 	void step() override {
 		ThemedModuleWidget<OrestesOneModule>::step();
 		if (module) {
+			module->formatE1Feedback();
+
+			// Let the adaptive scan rate know when one of our parameters is moved with the mouse
+			if (module->processAdaptive) {
+				ParamWidget* pw = dynamic_cast<ParamWidget*>(APP->event->getDraggedWidget());
+				ParamHandle* h = pw && pw->module ? APP->engine->getParamHandle(pw->module->id, pw->paramId) : NULL;
+				module->paramDragged = h && h >= &module->paramHandles[0] && h < &module->paramHandles[MAX_CHANNELS];
+			}
+
 			// MEM
 			if (module->e1ProcessPrev || expMemPrevTrigger.process(module->params[OrestesOneModule::PARAM_PREV].getValue())) {
 			    module->e1ProcessPrev = false;
@@ -326,10 +335,7 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 			if (module->midiMapLibraryFilename.empty()) {
 				// DEBUG("No known mapping library, so try and load default or factory library");
 				// Load default mapping library else load and save plugin factory library
-				bool midiMapLoaded = module->loadDefaultMappingLibraryFromPresetFolder();
-				if (!midiMapLoaded) {
-					module->createMappingLibraryFromFactory();
-				}
+				module->loadMappingLibrary();
 			}
 
 		
@@ -525,7 +531,8 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 
 		// Update library filename
 		module->midiMapLibraryFilename = path;
-		module->expMemPluginDeleteAll();
+		// Start from an empty library, leaving the one of the previous file to the instances sharing it
+		module->resetMap();
 		module->expMemSaveLibrary(true);
 	}
 
@@ -550,29 +557,13 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 	void loadMidiMapLibrary_action(std::string filename) {
 		// DEBUG("Loading mapping library from file %s", filename.c_str());
 
-		FILE* file = fopen(filename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load file %s", filename.c_str());
-			return;
-		}
-		DEFER({
-			fclose(file);
-		});
-
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		if (!libraryJ) {
-			std::string message = string::f("File is not a valid JSON file. Parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
+		json_t* currentStateJ = toJson();
+		if (!module->readMappingLibraryFile(filename)) {
+			json_decref(currentStateJ);
+			std::string message = string::f("File %s is not a valid mapping library file", filename.c_str());
 			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
 			return;
 		}
-		DEFER({
-			json_decref(libraryJ);
-		});
-
-		json_t* currentStateJ = toJson();
-		if (!module->loadMidiMapFromLibrary(libraryJ))
-			return;
 
 		// Update library filename
 		module->midiMapLibraryFilename = filename;
@@ -711,26 +702,27 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 		size_t i;
 		json_t* midiMapJJ;
 		int importedModules = 0;
-		json_array_foreach(midiMapJ, i, midiMapJJ) {
-			std::string importedPluginSlug = json_string_value(json_object_get(midiMapJJ, "ps"));
-			std::string importedModuleSlug = json_string_value(json_object_get(midiMapJJ, "ms"));
-
-			// Find this mapped module in the current Orestes module midiMap
-			auto p = std::pair<std::string, std::string>(importedPluginSlug, importedModuleSlug);
-			auto it = module->midiMap.find(p);
-			if (it != module->midiMap.end()) {
-				if (skipPremappedModules) {
-					continue;
+		module->waitForMappingLibrary();
+		module->midiMap.update([&](MappingLibrary& lib) {
+			json_array_foreach(midiMapJ, i, midiMapJJ) {
+				std::string importedPluginSlug = json_string_value(json_object_get(midiMapJJ, "ps"));
+				std::string importedModuleSlug = json_string_value(json_object_get(midiMapJJ, "ms"));
+
+				// Find this mapped module in the current Orestes module midiMap
+				if (lib.find(importedPluginSlug, importedModuleSlug)) {
+					if (skipPremappedModules) {
+						continue;
+					}
+					lib.erase(importedPluginSlug, importedModuleSlug);
 				}
-				delete it->second;
-				module->midiMap.erase(p);
-			}
-			
-			// Add new entry to midiMap
-			module->midiMapJSONToMidiMap(midiMapJJ);
-			importedModules++;
-			
-		};
+
+				// Add new entry to midiMap
+				std::string pluginSlug, moduleSlug;
+				if (!MappingLibrary::fromJson(midiMapJJ, pluginSlug, moduleSlug, module->loadedMapping)) continue;
+				lib.set(pluginSlug, moduleSlug, module->loadedMapping);
+				importedModules++;
+			};
+		});
 
 		// currentStateJ* now has the updated merged midimap
 		//DEBUG("Imported mappings for %d modules", importedModules);
@@ -971,7 +963,6 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 
 	void appendContextMenu(Menu* menu) override {
 		ThemedModuleWidget<OrestesOneModule>::appendContextMenu(menu);
-		int sampleRate = int(APP->engine->getSampleRate());
 
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createSubmenuItem("Preset load", "",
@@ -981,15 +972,48 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 			}
 		));
 		menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Precision", {
-				{ 2048, string::f("High (%i Hz)", sampleRate / 2048) },
-				{ 4098, string::f("Medium (%i Hz)", sampleRate / 4098) },
-				{ 8192, string::f("Low (%i Hz)", sampleRate / 8192) }
+				{ 46, string::f("High (%i Hz)", CONTROL_RATE / 46) },
+				{ 93, string::f("Medium (%i Hz)", CONTROL_RATE / 93) },
+				{ 186, string::f("Low (%i Hz)", CONTROL_RATE / 186) }
 			},
 			[=]() {
-				return module->processDivision;
+				return module->processInterval;
 			},
-			[=](int division) {
-				module->setProcessDivision(division);
+			[=](int interval) {
+				module->setProcessInterval(interval);
+			}
+		));
+		menu->addChild(createSubmenuItem("Adaptive precision", module->processAdaptive ? "On" : "",
+			[=](Menu* menu) {
+				menu->addChild(createBoolMenuItem("Enabled", "",
+					[=]() { return module->processAdaptive; },
+					[=](bool adaptive) { module->setProcessAdaptive(adaptive); }
+				));
+				menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Ceiling", {
+						{ 10, string::f("%i Hz", CONTROL_RATE / 10) },
+						{ 23, string::f("%i Hz", CONTROL_RATE / 23) },
+						{ 46, string::f("%i Hz", CONTROL_RATE / 46) }
+					},
+					[=]() {
+						return module->processIntervalMin;
+					},
+					[=](int ms) {
+						module->setProcessIntervalLimits(ms, module->processIntervalMax);
+					}
+				));
+				menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Floor", {
+						{ 186, string::f("%i Hz", CONTROL_RATE / 186) },
+						{ 372, string::f("%i Hz", CONTROL_RATE / 372) },
+						{ 1000, string::f("%i Hz", CONTROL_RATE / 1000) }
+					},
+					[=]() {
+						return module->processIntervalMax;
+					},
+					[=](int ms) {
+						module->setProcessIntervalLimits(module->processIntervalMin, ms);
+					}
+				));
+				menu->addChild(createMenuLabel(string::f("Current rate: %.1f Hz", float(CONTROL_RATE) / module->processIntervalCurrent)));
 			}
 		));
 		menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<MIDIMODE>("Mode", {
@@ -1003,6 +1027,10 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 				module->setMode(midiMode);
 			}
 		));
+		if (module->lastSwitchUs >= 0) {
+			menu->addChild(createMenuLabel(string::f("Last module switch: %lld µs, %i param handle updates",
+				(long long)module->lastSwitchUs, module->lastSwitchHandleUpdates)));
+		}
 		menu->addChild(createSubmenuItem("Re-send MIDI feedback", "",
 			[=](Menu* menu) {
 				menu->addChild(createMenuItem("Now", "", [=]() { module->midiResendFeedback(); }));
@@ -1054,7 +1082,6 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 					OrestesOneModule* module;
 					std::string pluginSlug;
 					std::string moduleSlug;
-					MemModule* midimapModule;
 					MidimapModuleItem() {
 						rightText = RIGHT_ARROW;
 					}
@@ -1102,20 +1129,19 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 
 
 						std::list<std::pair<std::string, MidimapModuleItem*>> l; 
-						for (auto it : module->midiMap) {
-							if (it.first.first == pluginSlug) {
-								MemModule* a = it.second;
+						MappingLibraryCache::Snapshot lib = module->midiMap.get();
+						for (const MappingLibrary::Entry* a : lib->sorted()) {
+							if (lib->str(a->pluginSlug) == pluginSlug) {
 								MidimapModuleItem* midimapModuleItem = new MidimapModuleItem;
 								if (a->autoMapped) {
-									midimapModuleItem->text = string::f("%s (A)", a->moduleName.c_str());
+									midimapModuleItem->text = string::f("%s (A)", lib->str(a->moduleName).c_str());
 								} else {
-									midimapModuleItem->text = string::f("%s", a->moduleName.c_str());
+									midimapModuleItem->text = string::f("%s", lib->str(a->moduleName).c_str());
 								}
 								
 								midimapModuleItem->module = module;
-								midimapModuleItem->midimapModule = a;
-								midimapModuleItem->pluginSlug = it.first.first;
-								midimapModuleItem->moduleSlug = it.first.second;
+								midimapModuleItem->pluginSlug = lib->str(a->pluginSlug);
+								midimapModuleItem->moduleSlug = lib->str(a->moduleSlug);
 								l.push_back(std::pair<std::string, MidimapModuleItem*>(midimapModuleItem->text, midimapModuleItem));
 							}
 						}
@@ -1136,14 +1162,14 @@ struct OrestesOneWidget : ThemedModuleWidget<OrestesOneModule>, ParamWidgetConte
 				std::map<std::string, MidimapPluginItem*> l;
 				l.clear();
 
-				for (auto it : module->midiMap) {
-					MemModule* a = it.second;
-					if (l.find(it.first.first) == l.end()) {
+				MappingLibraryCache::Snapshot lib = module->midiMap.get();
+				for (const MappingLibrary::Entry* a : lib->sorted()) {
+					if (l.find(lib->str(a->pluginName)) == l.end()) {
 						// Map does not already have an entry for this plugin, so add one now
 						MidimapPluginItem* midimapPluginItem = new MidimapPluginItem;
-						midimapPluginItem->text = string::f("%s", a->pluginName.c_str());
+						midimapPluginItem->text = string::f("%s", lib->str(a->pluginName).c_str());
 						midimapPluginItem->module = module;
-						midimapPluginItem->pluginSlug = it.first.first;
+						midimapPluginItem->pluginSlug = lib->str(a->pluginSlug);
 						l[midimapPluginItem->text] = midimapPluginItem;	
 					}
 				}
@@ -1,6 +1,8 @@
 #include "plugin.hpp"
 #include "Pylades.hpp"
 #include "MapModuleBase.hpp"
+#include "MappingLibraryCache.hpp"
+#include "MappingLibraryLoader.hpp"
 #include "digital/ScaledMapParam.hpp"
 #include "components/MenuLabelEx.hpp"
 #include "components/SubMenuSlider.hpp"
@@ -13,6 +15,8 @@
 #include <sstream>
 #include <string>
 #include <array>
+#include <atomic>
+#include <mutex>
 
 namespace RSBATechModules {
 namespace Pylades {
@@ -26,63 +30,116 @@ struct OscOutput {
 
     OscOutput(PyladesModule& module): moduleRef(module) {
 		reset();
-		b.reserve(1, 2);
 	}
 
 	void reset() {
 		std::fill_n(lastNPRNValuesSent.begin(), MAX_CHANNELS, -1);
-    	b.clear();
+		std::fill_n(unsentValues.begin(), MAX_CHANNELS, -1);
+		hasUnsentValues = false;
 	}
 
 	/**
 	 * Send fader value, and optionally rich display value and name
 	 */
-    void sendOscControlUpdate(int id, const char* name, const char* displayValue) {
+    bool sendOscControlUpdate(int id, const char* name, const char* displayValue) {
         
         if (moduleRef.sending) {
-	        TheModularMind::OscBundle feedbackBundle;
-			TheModularMind::OscMessage infoMessage;
-
-			infoMessage.setAddress("/fader/info");
-			infoMessage.addIntArg(id); // controller id
-			infoMessage.addStringArg(displayValue); // displayValue
-		    infoMessage.addStringArg(name); // parameter display name
-			feedbackBundle.addMessage(infoMessage);
-		
+			// controller id, displayValue, parameter display name
+			return moduleRef.oscSender.sendMessage("/fader/info", id, displayValue, name);
+        }
+		return false;
+
+   }
 
-			moduleRef.oscSender.sendBundle(feedbackBundle);	
+	/**
+	 * Send the display value of a fader without its unit, for protocol revision 2 clients which have the name
+	 * and unit from the /module/meta block
+	 */
+    bool sendOscControlValue(int id, const char* displayValue) {
+        if (moduleRef.sending) {
+			return moduleRef.oscSender.sendMessage("/fader/value", id, displayValue);
         }
-		
+        return false;
+   }
+
+   /**
+    * Start of a metadata block: content hash, number of /module/meta/fader messages that follow and controls per page
+    */
+   bool sendMetadataBegin(uint32_t hash, int count) {
+		if (moduleRef.sending) {
+			return moduleRef.oscSender.sendMessage("/module/meta", (int)hash, count, (int)NPRNS_PER_PAGE);
+		}
+		return false;
+   }
+
+   bool sendMetadataFader(int id, const char* name, const char* unit) {
+		if (moduleRef.sending) {
+			return moduleRef.oscSender.sendMessage("/module/meta/fader", id, name, unit);
+		}
+		return false;
+   }
 
+   bool sendMetadataEnd(uint32_t hash) {
+		if (moduleRef.sending) {
+			return moduleRef.oscSender.sendMessage("/module/meta/end", (int)hash);
+		}
+		return false;
    }
 
    /**
-    * Inform TouchOSC that a change module action is starting
+    * One part of a module snapshot, see PyladesModule::sendSnapshot()
     */
-   void changeOSCModule(const char* moduleName, const char* moduleDisplayName, float moduleY, float moduleX, int maxNprnId, const std::array<std::string, MAX_PAGES>& pageLabels) {
+   void sendSnapshot(int part, int parts, const char* blob, int size) {
+		if (moduleRef.sending) {
+			moduleRef.oscSender.sendMessage("/module/snapshot", part, parts, osc::Blob(blob, size));
+		}
+   }
 
+   /**
+    * Replies to /pylades/protocol with the protocol revision used from now on
+    */
+   void sendProtocolAck(int version) {
 		if (moduleRef.sending) {
-	   		TheModularMind::OscBundle feedbackBundle;
-			TheModularMind::OscMessage infoMessage;
-
-			infoMessage.setAddress("/module/changing");
-			infoMessage.addStringArg(moduleName);
-			infoMessage.addStringArg(moduleDisplayName);
-			infoMessage.addFloatArg(moduleY);
-			infoMessage.addFloatArg(moduleX);
-			infoMessage.addIntArg(maxNprnId);
-		    for (auto it: pageLabels) {
-		    	if (!it.empty()) {
-		    		infoMessage.addStringArg(it.c_str());
-		    	} else {
-		    		infoMessage.addStringArg("");
-		    	}
-		    }	
-
-			feedbackBundle.addMessage(infoMessage);
-			moduleRef.oscSender.sendBundle(feedbackBundle);
+			moduleRef.oscSender.sendMessage("/pylades/protocol", version);
+		}
+   }
+
+   /**
+    * Inform TouchOSC that a change module action is starting. Module switches are applied on the UI thread, so the
+    * message is only queued here and sent by the engine thread, see sendModuleChange().
+    */
+   void changeOSCModule(const char* moduleName, const char* moduleDisplayName, float moduleY, float moduleX, int maxNprnId, const std::array<std::string, MAX_PAGES>& pageLabels) {
+		std::lock_guard<std::mutex> lock(moduleChangeMutex);
+		moduleChange.moduleName = moduleName;
+		moduleChange.moduleDisplayName = moduleDisplayName;
+		moduleChange.moduleY = moduleY;
+		moduleChange.moduleX = moduleX;
+		moduleChange.maxNprnId = maxNprnId;
+		moduleChange.pageLabels = pageLabels;
+		moduleChangePending = true;
+   }
 
+   /**
+    * Engine thread. Sends the /module/changing queued by changeOSCModule(), ahead of the messages of the new module.
+    * Never waits for the lock, returns false if the UI thread is still queueing a change so it can be sent later.
+    */
+   bool sendModuleChange() {
+		if (!moduleChangePending) return true;
+		std::unique_lock<std::mutex> lock(moduleChangeMutex, std::try_to_lock);
+		if (!lock.owns_lock()) return false;
+		moduleChangePending = false;
+		if (moduleRef.sending) {
+			moduleRef.oscSender.sendPacket([this](osc::OutboundPacketStream& p) {
+				p << osc::BeginMessage("/module/changing")
+				  << moduleChange.moduleName.c_str() << moduleChange.moduleDisplayName.c_str()
+				  << moduleChange.moduleY << moduleChange.moduleX << (osc::int32)moduleChange.maxNprnId;
+			    for (const std::string& it: moduleChange.pageLabels) {
+			    	p << it.c_str();
+			    }
+				p << osc::EndMessage;
+			});
 		}
+		return true;
    }
 
  	/**
@@ -91,13 +148,7 @@ struct OscOutput {
    void endChangeE1Module() {
 
    		if (moduleRef.sending) {
-	       	TheModularMind::OscBundle feedbackBundle;
-			TheModularMind::OscMessage infoMessage;
-
-			infoMessage.setAddress("/module/end");
-			feedbackBundle.addMessage(infoMessage);
-		
-			moduleRef.oscSender.sendBundle(feedbackBundle);
+			moduleRef.oscSender.sendMessage("/module/end");
 		}
 
    }
@@ -142,11 +193,7 @@ struct OscOutput {
    }
 
     void sendStartMappedModuleList() {
-    	TheModularMind::OscBundle moduleBundle;
-    	TheModularMind::OscMessage moduleMessage;
-		moduleMessage.setAddress("/module/startmml");
-		moduleBundle.addMessage(moduleMessage);
-		moduleRef.oscSender.sendBundle(moduleBundle);
+		moduleRef.oscSender.sendMessage("/module/startmml");
     }
     void mappedModuleInfo(RackMappedModuleListItem& m, TheModularMind::OscBundle& mappedModulesBundle) {
 		TheModularMind::OscMessage moduleMessage;
@@ -158,59 +205,97 @@ struct OscOutput {
 		mappedModulesBundle.addMessage(moduleMessage);
     }
     void sendEndMappedModuleList() {
-    	TheModularMind::OscBundle moduleBundle;
-       	TheModularMind::OscMessage moduleMessage;
-       	moduleMessage.setAddress("/module/endmml");
-		moduleBundle.addMessage(moduleMessage);
-		moduleRef.oscSender.sendBundle(moduleBundle);
+		moduleRef.oscSender.sendMessage("/module/endmml");
     }
     
     void sendPyladesVersion(std::string o1Version) {
 
     	if (moduleRef.sending) {
-	    	TheModularMind::OscBundle feedbackBundle;
-			TheModularMind::OscMessage infoMessage;
-
-			infoMessage.setAddress("/pylades/version");
-			infoMessage.addStringArg(o1Version);
-			feedbackBundle.addMessage(infoMessage);
-		
-			moduleRef.oscSender.sendBundle(feedbackBundle);
+			moduleRef.oscSender.sendMessage("/pylades/version", o1Version);
 		}
 
     } 
 
+    /**
+     * Replies to /pylades/sync, telling the client whether the range is being re-sent
+     */
+    void sendSyncAck(int seq, bool divergent) {
+    	if (moduleRef.sending) {
+			moduleRef.oscSender.sendMessage("/pylades/syncack", seq, divergent ? 1 : 0);
+		}
+    }
+
     bool setPackedNPRNValue(int value, int nprn, int valueNprnIn, bool force = false) {
 
-		if ((value == lastNPRNValuesSent[nprn] || value == valueNprnIn || !moduleRef.sending) && !force) {
+		if (snapshotting && moduleRef.sending) {
+			// Sent with the snapshot instead
+			lastNPRNValuesSent[nprn] = value;
+			unsentValues[nprn] = -1;
+			return true;
+		}
+		// A different value waiting in unsentValues is replaced by this one
+		bool replacesUnsent = unsentValues[nprn] >= 0 && unsentValues[nprn] != value;
+		if ((value == lastNPRNValuesSent[nprn] || value == valueNprnIn || !moduleRef.sending) && !force && !replacesUnsent) {
 			return false;
 		}
     	// DEBUG("Sending value %d nprn %d valueNprnIn %d lastNPRNValuesSent %d force %d", value, nprn, valueNprnIn, lastNPRNValuesSent[nprn], force);
 
+		// A value the sender dropped is recorded as sent only once sendUnsentValues() got it through
+		if (!moduleRef.oscSender.sendMessage("/fader", nprn, value)) {
+			unsentValues[nprn] = value;
+			hasUnsentValues = true;
+			return true;
+		}
+		unsentValues[nprn] = -1;
 		lastNPRNValuesSent[nprn] = value;
-
-		TheModularMind::OscBundle valueBundle;
-		TheModularMind::OscMessage valueMessage;
-	
-		valueMessage.setAddress("/fader");
-		valueMessage.addIntArg(nprn);
-		valueMessage.addIntArg(value);
-		valueBundle.addMessage(valueMessage);
-
-		moduleRef.oscSender.sendBundle(valueBundle);
 		return true;
 
     }
 
+	/** Sends the /fader values the sender dropped before, see setPackedNPRNValue() */
+	void sendUnsentValues() {
+		if (!hasUnsentValues || !moduleRef.sending) return;
+		hasUnsentValues = false;
+		for (int nprn = 0; nprn < MAX_CHANNELS; nprn++) {
+			if (unsentValues[nprn] < 0) continue;
+			if (moduleRef.oscSender.sendMessage("/fader", nprn, unsentValues[nprn])) {
+				lastNPRNValuesSent[nprn] = unsentValues[nprn];
+				unsentValues[nprn] = -1;
+			}
+			else {
+				hasUnsentValues = true;
+			}
+		}
+	}
+
+	/** From a module switch until its snapshot is sent, values are only recorded, see sendSnapshot() */
+	bool snapshotting = false;
+
 private:
 	std::array<int, MAX_CHANNELS> lastNPRNValuesSent{};
-	// Assume can re-use a single OscBundle, maybe not thread safe ?
-    TheModularMind::OscBundle b;
+	/** Values the sender dropped, -1 if none. The caller counts them as sent, so they are sent again here. */
+	std::array<int, MAX_CHANNELS> unsentValues{};
+	bool hasUnsentValues = false;
 	PyladesModule& moduleRef;
 
+	/** The /module/changing waiting for the engine thread */
+	struct ModuleChange {
+		std::string moduleName;
+		std::string moduleDisplayName;
+		float moduleY = 0.f;
+		float moduleX = 0.f;
+		int maxNprnId = 0;
+		std::array<std::string, MAX_PAGES> pageLabels;
+	};
+	ModuleChange moduleChange;
+	std::mutex moduleChangeMutex;
+	std::atomic<bool> moduleChangePending{false};
+
 };
 
-	TheModularMind::OscReceiver oscReceiver;
+	/** Newest /fader value of each NPRN, written by the OSC listener thread. Declared before oscReceiver so it outlives it. */
+	TheModularMind::OscValueTable<MAX_NPRN_ID + 1> oscFaderTable;
+	TheModularMind::OscReceiver<MAX_NPRN_ID + 1> oscReceiver;
 	TheModularMind::OscSender oscSender;
 	std::string ip = "localhost";
 	std::string rxPort = RXPORT_DEFAULT;
@@ -273,6 +358,7 @@ private:
             if (module->oscOutput.setPackedNPRNValue(value, nprn, module->valuesNprn[nprn], current == -1)) {
             	// Assume OSC client will assign its control to the value we just sent, without waiting to find out if it did
             	module->valuesNprn[nprn] = -1;
+            	module->controllerValues[nprn] = value;
             }
             if (!sendOnly) current = value;
         }
@@ -280,6 +366,7 @@ private:
         void reset() {
             nprn = -1;
             current = -1;
+            module->nprnIndexDirty = true;
 
         }
 
@@ -294,6 +381,7 @@ private:
         void setNprn(int nprn) {
             this->nprn = nprn;
             current = -1;
+            module->nprnIndexDirty = true;
         }
 
         bool get14bit() {
@@ -305,7 +393,7 @@ private:
         }
     };
 
-    OscOutput oscOutput = OscOutput(*this); 
+    OscOutput oscOutput{*this};
 
 	/** Number of maps */
 	int mapLen = 0;
@@ -380,6 +468,17 @@ private:
 	/** The parameter value of each NPRN control as received via OSC (values in range 0 .. ) */
     int valuesNprn[MAX_NPRN_ID+1];
     uint32_t valuesNprnTs[MAX_NPRN_ID+1];
+	/** Channels mapped to each NPRN, as lists linked through nprnChannelNext. Rebuilt when nprnIndexDirty is set. */
+	int nprnChannelHead[MAX_NPRN_ID+1];
+	int nprnChannelNext[MAX_CHANNELS];
+	bool nprnIndexDirty = true;
+	static const int DIRTY_WORDS = (MAX_CHANNELS + 63) / 64;
+	/** One bit per channel whose NPRN has received a value since the last processMappings() */
+	uint64_t dirtyChannels[DIRTY_WORDS] = {};
+	/** Last value of each NPRN sent to or received from the OSC client since the last module change, -1 if none */
+	int controllerValues[MAX_NPRN_ID+1];
+	/** Set once the OSC client sends /pylades/sync, which then replaces the periodic re-send */
+	bool controllerSyncs = false;
 	
 	MIDIMODE midiMode = MIDIMODE::MIDIMODE_DEFAULT;
 
@@ -394,13 +493,51 @@ private:
 
 	/** [Stored to Json] */
 	RackParam rackParam[MAX_CHANNELS];
+	/** Control page shown by the controller (0 based), -1 if unknown. Feedback for the other pages is deferred. */
+	int visiblePage = -1;
+	/** Channels whose feedback is pending because their page is not shown */
+	bool feedbackDeferred[MAX_CHANNELS];
+	/** Feedback messages for hidden pages still allowed in the current scan */
+	int hiddenFeedbackBudget = 0;
+	/** Scan all channels on the next control tick, e.g. after a page change */
+	bool scanRequested = false;
+	/** Feedback protocol revision the client asked for with /pylades/protocol, 1 until it does */
+	int protocolVersion = 1;
+	/** A name or unit changed since the last metadata block was sent */
+	bool metadataChanged = false;
+	/** The marker of a module switch is on its way, the metadata block waits for it */
+	bool feedbackMarkerPending = false;
+	/** Blob of the /module/snapshot part being built */
+	char snapshotBlob[TheModularMind::OscSender::ENCODE_BUFFER_SIZE];
+	/** Display texts of the channels, formatted by the widget */
+	FeedbackTexts<MAX_CHANNELS> feedbackTexts;
+	/** Slew filters of all rackParam channels, stepped together once per processMappings() pass */
+	ChannelBank channelBank;
+	/** Engine frame of the previous processMappings() pass */
+	int64_t lastMappingsFrame = -1;
 	/** [Stored to Json] */
 	bool oscResendPeriodically;
 	dsp::ClockDivider midiResendDivider;
 
 	dsp::ClockDivider processDivider;
-	/** [Stored to Json] */
-	int processDivision;
+	/** [Stored to Json] Milliseconds between the scans for parameter changes made in Rack */
+	int processInterval;
+	/** [Stored to Json] Scan fast while controls are in use and back off when idle, instead of processInterval */
+	bool processAdaptive;
+	/** [Stored to Json] Shortest and longest scan interval of the adaptive mode, in milliseconds */
+	int processIntervalMin;
+	int processIntervalMax;
+	/** Scan interval in effect */
+	int processIntervalCurrent;
+	/** A mapped parameter changed or received a value since the last scan */
+	bool processActivity = false;
+	/** Set by the widget while one of the mapped parameters is dragged with the mouse */
+	bool paramDragged = false;
+	/** Samples per control tick, and samples counted since the last tick */
+	int controlFrames = 1;
+	int controlCounter = 0;
+	/** [Stored to Json] Largest bundle of OSC feedback sent per datagram */
+	int oscMaxDatagramSize;
 	dsp::ClockDivider indicatorDivider;
 	dsp::ClockDivider lightDivider;
 
@@ -410,14 +547,21 @@ private:
 	// MEM-
 	// Pointer of the MEM's attribute
 	int64_t expMemModuleId = -1;
+	/** Duration of the last module switch in µs (-1 before the first), and the param handle updates it took */
+	int64_t lastSwitchUs = -1;
+	int lastSwitchHandleUpdates = 0;
 
 	/** [Stored to JSON] */
 	std::string midiMapLibraryFilename;
 	/** [Stored to JSON] */
 	bool autosaveMappingLibrary = true;
 
-	/** Internal module midiMap. Not saved to module Json. */
-	std::map<std::pair<std::string, std::string>, MemModule*> midiMap;
+	/** Internal module midiMap, shared with the other instances using the same library file. Not saved to module Json. */
+	SharedMappingLibrary midiMap;
+	/** Reused by expMemApply() and the preset import, UI thread */
+	MappingLibrary::Mapping loadedMapping;
+	/** Loads the library of dataFromJson() off the engine thread */
+	MappingLibraryLoader libraryLoader;
 
 	/** [Stored to JSON] 
 	 * Stores rack-level mapping e.g. for Patchmaster mappings
@@ -436,21 +580,29 @@ private:
 		configParam<BufferedTriggerParamQuantity>(PARAM_NEXT, 0.f, 1.f, 0.f, "Scan for next module mapping");
 		configParam<BufferedTriggerParamQuantity>(PARAM_APPLY, 0.f, 1.f, 0.f, "Apply mapping");
 
+		channelBank.setChannels(MAX_CHANNELS);
 		for (int id = 0; id < MAX_CHANNELS; id++) {
 			paramHandles[id].color = mappingIndicatorColor;
 			APP->engine->addParamHandle(&paramHandles[id]);
+			rackParam[id].setBank(&channelBank, id);
 			rackParam[id].setLimits(0, 16384, -1);
 			nprns[id].module = this;
 			nprns[id].id = id;
 		}
-		indicatorDivider.setDivision(2048);
-		lightDivider.setDivision(2048);
-		midiResendDivider.setDivision(APP->engine->getSampleRate() / 2);
+		// All dividers count control ticks, i.e. milliseconds
+		indicatorDivider.setDivision(46);
+		lightDivider.setDivision(46);
+		midiResendDivider.setDivision(CONTROL_RATE / 2);
+		onSampleRateChange();
+		oscReceiver.setAddressResolver([](const char* address) { return (int)resolveOscCommand(address); });
+		oscReceiver.setValueTable(&oscFaderTable, (int)OSCCOMMAND::FADER);
 		onReset();
 		oscMappedModuleList.reserve(INITIAL_MAPPED_MODULE_LIST_SIZE);
 	}
 
 	~PyladesModule() {
+		// The loader thread publishes to midiMap
+		libraryLoader.stop();
 		for (int id = 0; id < MAX_CHANNELS; id++) {
 			APP->engine->removeParamHandle(&paramHandles[id]);
 		}
@@ -467,10 +619,14 @@ private:
 		for (int i = 0; i <= MAX_NPRN_ID; i++) {
 		    valuesNprn[i] = -1;
 		    valuesNprnTs[i] = 0;
+		    controllerValues[i] = -1;
 		}
+		controllerSyncs = false;
+		visiblePage = -1;
 		for (int i = 0; i < MAX_CHANNELS; i++) {
 			lastValueIn[i] = -1;
 			lastValueOut[i] = -1;
+			feedbackDeferred[i] = false;
 			nprns[i].nprnMode = NPRNMODE::DIRECT;
 			textLabel[i] = "";
 			midiOptions[i] = 0;
@@ -486,9 +642,11 @@ private:
 		oscIgnoreDevices = false;
 		oscResendPeriodically = false;
 		midiResendDivider.reset();
-		processDivision = 4098;
-		processDivider.setDivision(processDivision);
-		processDivider.reset();
+		processAdaptive = false;
+		processIntervalMin = 10;
+		processIntervalMax = 372;
+		setProcessInterval(93);
+		setOscMaxDatagramSize(TheModularMind::OscSender::MTU_DATAGRAM_SIZE);
 		overlayEnabled = true;
 		clearMapsOnLoad = false;
 		
@@ -507,14 +665,18 @@ private:
 	}
 
 	void resetMap() {
-		for (auto it : midiMap) {
-			delete it.second;
-		}
-		midiMap.clear();
+		libraryLoader.cancel();
+		midiMap.reset();
+	}
+
+	/** Waits for a library still loading, so changes apply to it rather than being replaced by it. UI thread. */
+	void waitForMappingLibrary() {
+		libraryLoader.wait();
 	}
 
 	void onSampleRateChange() override {
-		midiResendDivider.setDivision(APP->engine->getSampleRate() / 2);
+		controlFrames = std::max(1, int(std::round(APP->engine->getSampleRate() / CONTROL_RATE)));
+		controlCounter = 0;
 	}
 
 	bool isValidPort(std::string port) {
@@ -556,41 +718,61 @@ private:
 	}
 
 	/**
-	 * Reads current parameter values for current mapped parameters and sends info via OSC
+	 * Queues the parameter name and display value of a channel to be sent via OSC. The widget formats them,
+	 * see formatFeedbackText(), and processFeedbackTexts() sends them.
 	 */
     void sendOSCFeedback(int id) {
+       feedbackTexts.request(id);
+    }
+
+    /** UI thread, called from the widget's step() */
+    void formatOSCFeedback() {
+       feedbackTexts.format([this](FeedbackTexts<MAX_CHANNELS>::Text& t) { return formatFeedbackText(t); });
+    }
 
-       if (id >= mapLen) return;
-       // Update E1 control with mapped parameter name and value
-       if (paramHandles[id].moduleId < 0) return;
+    /** UI thread. Fills in the parameter name and display value of channel t.id, returns false if it has none. */
+    bool formatFeedbackText(FeedbackTexts<MAX_CHANNELS>::Text& t) {
+       int id = t.id;
+       if (id >= mapLen) return false;
+       if (paramHandles[id].moduleId < 0) return false;
 
        ModuleWidget* mw = APP->scene->rack->getModule(paramHandles[id].moduleId);
-       if (!mw) return;
+       if (!mw) return false;
 
        Module* m = mw->getModule();
-       if (!m) return;
+       if (!m) return false;
        //idx of parameter in target module
        int paramId = paramHandles[id].paramId;
-       if (paramId >= (int)m->params.size()) return;
+       if (paramId >= (int)m->params.size()) return false;
 
        ParamQuantity* paramQuantity = m->paramQuantities[paramId];
-       std::stringstream ss;
-       ss << paramQuantity->getDisplayValueString() << " " << paramQuantity->getUnit();
        std::string paramName;
        if (textLabel[id].empty()) {
        		paramName = paramQuantity->getLabel();
        } else {
        		paramName = textLabel[id];
        }
-       oscOutput.sendOscControlUpdate(nprns[id].getNprn(), paramName.c_str(), ss.str().c_str());
+       t.set(paramName.c_str(), paramQuantity->getDisplayValueString().c_str(), paramQuantity->getUnit().c_str());
+       return true;
     }
 
     void process(const ProcessArgs &args) override {
+		// The audio-rate path is only this counter, all work happens once per control tick
+		if (++controlCounter < controlFrames) return;
+		controlCounter = 0;
+		processControl(args);
+	}
+
+	void processControl(const ProcessArgs &args) {
 		ts++;
 
 		// Aquire new OSC message from the Receiver
-		TheModularMind::OscMessage rxMessage;
+		TheModularMind::OscInboundMessage rxMessage;
 		oscReceived = false;
+		oscFaderTable.consume([this](int nprn, int value) {
+			bool r = processFaderValue(nprn, value);
+			oscReceived = oscReceived || r;
+		});
 		while(oscReceiver.shift(&rxMessage)) {
 			bool r = processOscMessage(rxMessage);
 			oscReceived = oscReceived || r;
@@ -598,7 +780,7 @@ private:
 
 		// Handle indicators - blinking
 		if (indicatorDivider.process()) {
-			float t = indicatorDivider.getDivision() * args.sampleTime;
+			float t = indicatorDivider.getDivision() * (1.f / CONTROL_RATE);
 			for (int i = 0; i < mapLen; i++) {
 				paramHandles[i].color = mappingIndicatorHidden ? color::BLACK_TRANSPARENT : mappingIndicatorColor;
 				if (paramHandles[i].moduleId >= 0) {
@@ -607,7 +789,7 @@ private:
 			}
 		}
 
-		if (oscProcessResendOSCFeedback || (oscResendPeriodically && midiResendDivider.process())) {
+		if (oscProcessResendOSCFeedback || (oscResendPeriodically && !controllerSyncs && midiResendDivider.process())) {
 			oscResendFeedback();
 		}
 
@@ -658,175 +840,345 @@ private:
 
         // Only step channels when some OSC message has been received. Additionally
         // step channels for parameter changes made within VCVRack at a lower frequency.
-        bool stepParameterChange = processDivider.process();
+        bool stepParameterChange = processDivider.process() || scanRequested;
+        scanRequested = false;
+        if (processAdaptive && (oscReceived || paramDragged)) {
+            processActivity = true;
+            // Don't wait for the end of a long idle interval to pick up the pace
+            if (processIntervalCurrent > processIntervalMin) {
+                setProcessIntervalCurrent(processIntervalMin);
+                stepParameterChange = true;
+            }
+        }
         if (stepParameterChange || oscReceived) {
-            processMappings(args.sampleTime, stepParameterChange, oscReceived);
+            processMappings(args.sampleTime, stepParameterChange, oscReceived, args.frame);
             processOscCommands();
         }
+        if (stepParameterChange && processAdaptive) adaptProcessInterval();
+
+        // Send the display texts the widget has formatted since the last tick
+        if (!feedbackTexts.empty()) {
+            processFeedbackTexts();
+        }
 
 	}
 
-	void processMappings(float sampleTime, bool stepParameterChange, bool midiReceived) {
-		float st = sampleTime * float(processDivision);
+	void processMappings(float sampleTime, bool stepParameterChange, bool midiReceived, int64_t frame) {
+		float st = float(processIntervalCurrent) / CONTROL_RATE;
 
-		for (int id = 0; id < mapLen; id++) {
+		// A module switch is announced before any feedback of the new module, the pass is retried until it is
+		if (!oscOutput.sendModuleChange()) {
+			if (stepParameterChange) scanRequested = true;
+			return;
+		}
+		// Coalesce all OSC feedback of this pass into as few datagrams as possible
+		oscSender.beginBundle();
+		oscOutput.sendUnsentValues();
+
+		if (nprnIndexDirty) rebuildNprnIndex();
+		if (stepParameterChange) {
+			// Periodic scan of all channels, also picks up parameter changes made in Rack
+			hiddenFeedbackBudget = HIDDEN_FEEDBACK_PER_SCAN;
+			for (int id = 0; id < mapLen; id++) {
+				processMapping(id, st, stepParameterChange);
+			}
+			std::fill_n(dirtyChannels, DIRTY_WORDS, 0);
+		} else {
+			// Only the channels whose NPRN has received a new value
+			for (int w = 0; w < DIRTY_WORDS; w++) {
+				uint64_t bits = dirtyChannels[w];
+				dirtyChannels[w] = 0;
+				while (bits) {
+					int id = (w << 6) + __builtin_ctzll(bits);
+					bits &= bits - 1;
+					if (id < mapLen) processMapping(id, st, stepParameterChange);
+				}
+			}
+		}
+
+		// Step the slew of all channels by the time since the previous pass, once processMapping() has set the
+		// new targets
+		float dt = lastMappingsFrame >= 0 && frame > lastMappingsFrame ? sampleTime * float(frame - lastMappingsFrame) : st;
+		lastMappingsFrame = frame;
+		processSlew(dt);
+
+		// Send end of mapping message, when switching between saved module mappings
+		// NB: Module parameters may get processed in multiple process() calls, so we need to wait until all the module parameters
+		// have been send to OSC before sending the final endChangeE1Module command to the OSC. Their display texts are
+		// formatted by the widget, so the message is sent when the marker queued behind them comes back.
+        if (sendOSCEndMessage == 1) {
+          // The metadata block sent with the marker lists every mapped channel, also those on hidden pages
+          if (protocolVersion >= 2) requestAllFeedbackTexts();
+          feedbackTexts.requestMarker();
+          feedbackMarkerPending = true;
+          sendOSCEndMessage = 0;
+        }
+        oscSender.endBundle();
+	}
+
+	bool isNprnVisible(int nprn) {
+		if (visiblePage < 0) return true;
+		int page = nprn / NPRNS_PER_PAGE;
+		return page == visiblePage || page >= MAX_PAGES;
+	}
+
+	/** Page shown by the controller, 1 to MAX_PAGES, or 0 if it shows all of them */
+	bool setVisiblePage(int page) {
+		if (page < 0 || page > MAX_PAGES) return false;
+		visiblePage = page - 1;
+		// Catch up on the changes deferred for the page now shown
+		scanRequested = true;
+		return true;
+	}
+
+	void rebuildNprnIndex() {
+		nprnIndexDirty = false;
+		std::fill_n(nprnChannelHead, MAX_NPRN_ID + 1, -1);
+		for (int id = MAX_CHANNELS - 1; id >= 0; id--) {
 			int nprn = nprns[id].getNprn();
-			if (nprn < 0)
-				continue;
+			if (nprn < 0 || nprn > MAX_NPRN_ID) continue;
+			nprnChannelNext[id] = nprnChannelHead[nprn];
+			nprnChannelHead[nprn] = id;
+		}
+	}
+
+	/** Queues the channels mapped to an NPRN for the next processMappings() pass */
+	void markNprnDirty(int nprn) {
+		if (nprn < 0 || nprn > MAX_NPRN_ID) return;
+		if (nprnIndexDirty) rebuildNprnIndex();
+		for (int id = nprnChannelHead[nprn]; id >= 0; id = nprnChannelNext[id]) {
+			dirtyChannels[id >> 6] |= (uint64_t)1 << (id & 63);
+		}
+	}
 
-			// Get Module
+	/**
+	 * Steps the slew filters of all channels and applies their output, also on the channels processMapping() did
+	 * not visit in this pass
+	 */
+	void processSlew(float dt) {
+		channelBank.process(dt, mapLen);
+		if (midiMode != MIDIMODE::MIDIMODE_DEFAULT) return;
+		for (int id = 0; id < mapLen; id++) {
+			if (channelBank.lambda[id] == 0.f || nprns[id].getNprn() < 0) continue;
 			Module* module = paramHandles[id].module;
-			if (!module)
-				continue;
+			if (module && rackParam[id].hasTarget(module, paramHandles[id].paramId)) rackParam[id].processSlew();
+		}
+	}
+
+	/**
+	 * Steps one mapping channel: applies a new NPRN value to its parameter and sends feedback for parameter changes
+	 */
+	void processMapping(int id, float st, bool stepParameterChange) {
+		int nprn = nprns[id].getNprn();
+		if (nprn < 0)
+			return;
 
-			// Get ParamQuantity
-			int paramId = paramHandles[id].paramId;
+		// Get Module
+		Module* module = paramHandles[id].module;
+		if (!module)
+			return;
+
+		// Resolve the ParamQuantity only when the ParamHandle points somewhere new, rackParam[id] keeps the
+		// Param pointer and range for the following passes
+		int paramId = paramHandles[id].paramId;
+		if (!rackParam[id].hasTarget(module, paramId)) {
 			ParamQuantity* paramQuantity = module->paramQuantities[paramId];
 			if (!paramQuantity)
-				continue;
+				return;
 
 			if (!paramQuantity->isBounded())
-				continue;
+				return;
 
-			switch (midiMode) {
-				case MIDIMODE::MIDIMODE_DEFAULT: {
-					rackParam[id].paramQuantity = paramQuantity;
-					int t = -1;
+			rackParam[id].setTarget(module, paramId, paramQuantity);
+		}
+		ParamQuantity* paramQuantity = rackParam[id].paramQuantity;
+
+		switch (midiMode) {
+			case MIDIMODE::MIDIMODE_DEFAULT: {
+				int t = -1;
 
  
-                    if (!oscProcessResetParameter && nprn >= 0 && nprns[id].process()) {
-					    // Check if NPRN value has been set and changed
-						switch (nprns[id].nprnMode) {
-							case NPRNMODE::DIRECT:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									lastValueIn[id] = nprns[id].getValue();
+                if (!oscProcessResetParameter && nprn >= 0 && nprns[id].process()) {
+				    // Check if NPRN value has been set and changed
+					switch (nprns[id].nprnMode) {
+						case NPRNMODE::DIRECT:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								lastValueIn[id] = nprns[id].getValue();
+								t = nprns[id].getValue();
+							} else {
+								// DEBUG("Skipping changing rack value %d", lastValueIn[id]);
+							}
+							break;
+						case NPRNMODE::PICKUP1:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								if (rackParam[id].isNear(lastValueIn[id])) {
+									rackParam[id].resetFilter();
 									t = nprns[id].getValue();
-								} else {
-									// DEBUG("Skipping changing rack value %d", lastValueIn[id]);
-								}
-								break;
-							case NPRNMODE::PICKUP1:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									if (rackParam[id].isNear(lastValueIn[id])) {
-										rackParam[id].resetFilter();
-										t = nprns[id].getValue();
-									}
-									lastValueIn[id] = nprns[id].getValue();
-								}
-								break;
-							case NPRNMODE::PICKUP2:
-								if (lastValueIn[id] != nprns[id].getValue()) {
-									if (rackParam[id].isNear(lastValueIn[id], nprns[id].getValue())) {
-										rackParam[id].resetFilter();
-										t = nprns[id].getValue();
-									}
-									lastValueIn[id] = nprns[id].getValue();
-								}
-								break;
-							case NPRNMODE::TOGGLE:
-								if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
-									t = rackParam[id].getLimitMax();
-									lastValueIn[id] = -2;
 								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
-									t = rackParam[id].getLimitMax();
-									lastValueIn[id] = -3;
-								}
-								else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
-									t = rackParam[id].getLimitMin();
-									lastValueIn[id] = -4;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
-									t = rackParam[id].getLimitMin();
-									lastValueIn[id] = -1;
-								}
-								break;
-							case NPRNMODE::TOGGLE_VALUE:
-								if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								lastValueIn[id] = nprns[id].getValue();
+							}
+							break;
+						case NPRNMODE::PICKUP2:
+							if (lastValueIn[id] != nprns[id].getValue()) {
+								if (rackParam[id].isNear(lastValueIn[id], nprns[id].getValue())) {
+									rackParam[id].resetFilter();
 									t = nprns[id].getValue();
-									lastValueIn[id] = -2;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
-									t = rackParam[id].getValue();
-									lastValueIn[id] = -3;
-								}
-								else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
-									t = rackParam[id].getLimitMin();
-									lastValueIn[id] = -4;
-								}
-								else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
-									t = rackParam[id].getLimitMin();
-									lastValueIn[id] = -1;
 								}
-								break;
-						}
-					} 
-
-			        int v;
-
-					// Set a new value for the mapped parameter
-					if (oscProcessResetParameter && nprn == oscProcessResetParameterNPRN) {
-                        rackParam[id].setValueToDefault();
-                        oscProcessResetParameterNPRN = -1;
-                        lastValueOut[id] = -1;
-                        nprns[id].resetValue(); // Forces NPRN adapter to emit NPRN message out
-                    } else if (t >= 0) {
-						rackParam[id].setValue(t);
-						if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
+								lastValueIn[id] = nprns[id].getValue();
+							}
+							break;
+						case NPRNMODE::TOGGLE:
+							if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = rackParam[id].getLimitMax();
+								lastValueIn[id] = -2;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = rackParam[id].getLimitMax();
+								lastValueIn[id] = -3;
+							}
+							else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = rackParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = rackParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
+						case NPRNMODE::TOGGLE_VALUE:
+							if (nprns[id].getValue() > 0 && (lastValueIn[id] == -1 || lastValueIn[id] >= 0)) {
+								t = nprns[id].getValue();
+								lastValueIn[id] = -2;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -2) {
+								t = rackParam[id].getValue();
+								lastValueIn[id] = -3;
+							}
+							else if (nprns[id].getValue() > 0 && lastValueIn[id] == -3) {
+								t = rackParam[id].getLimitMin();
+								lastValueIn[id] = -4;
+							}
+							else if (nprns[id].getValue() == 0 && lastValueIn[id] == -4) {
+								t = rackParam[id].getLimitMin();
+								lastValueIn[id] = -1;
+							}
+							break;
 					}
+				} 
+
+		        int v;
+
+				// Set a new value for the mapped parameter
+				if (oscProcessResetParameter && nprn == oscProcessResetParameterNPRN) {
+                    rackParam[id].setValueToDefault();
+                    oscProcessResetParameterNPRN = -1;
+                    lastValueOut[id] = -1;
+                    nprns[id].resetValue(); // Forces NPRN adapter to emit NPRN message out
+                } else if (t >= 0) {
+					rackParam[id].setValue(t);
+					if (overlayEnabled && overlayQueue.capacity() > 0) overlayQueue.push(id);
+				}
 
-					// Apply value on the mapped parameter (respecting slew and scale)
-					rackParam[id].process(st);
-
-					// Retrieve the current value of the parameter (ignoring slew and scale)
-					v = rackParam[id].getValue();
-
-					// Midi feedback
-					if (lastValueOut[id] != v) {
-						if (!oscProcessResetParameter && nprn >= 0 && nprns[id].nprnMode == NPRNMODE::DIRECT)
-                        							lastValueIn[id] = v;
-				        
-						// Send enriched parameter feedback to OSC
-						// But only at the "processDivider" rate to control data rate sent to OSC.
-						// This means the displayed parameter values sent to OSC will lag the actual parameter value whilst
-						// the parameter is being changed (either from OSC or from the VCVRack GUI).
-						// Users can adjust the Pylades "Precision" to balance that lag with stability of the OSC client (reducing data traffic)
-						if (stepParameterChange) {
-							// Send manually altered parameter change out to OSC
-							nprns[id].setValue(v, lastValueIn[id] < 0);
-							lastValueOut[id] = v;
-							oscSent = true;
-							sendOSCFeedback(id);
-                        	oscProcessResetParameter = false;
-                       		 // If we are broadcasting parameter updates when switching modules,
-                       		 // record that we have now sent this parameter
-                        	if (sendOSCEndMessage > 0) sendOSCEndMessage--;
-                        }
+				// Apply value on the mapped parameter (respecting slew and scale)
+				rackParam[id].process(st);
+
+				// Retrieve the current value of the parameter (ignoring slew and scale)
+				v = rackParam[id].getValue();
+
+				// Midi feedback
+				if (lastValueOut[id] != v) {
+					if (!oscProcessResetParameter && nprn >= 0 && nprns[id].nprnMode == NPRNMODE::DIRECT)
+                    							lastValueIn[id] = v;
+			        
+					// Send enriched parameter feedback to OSC
+					// But only at the "processDivider" rate to control data rate sent to OSC.
+					// This means the displayed parameter values sent to OSC will lag the actual parameter value whilst
+					// the parameter is being changed (either from OSC or from the VCVRack GUI).
+					// Users can adjust the Pylades "Precision" to balance that lag with stability of the OSC client (reducing data traffic)
+					if (stepParameterChange && !isNprnVisible(nprn) && hiddenFeedbackBudget <= 0 && !oscOutput.snapshotting) {
+						// Not on the page the controller shows, leave the change pending for a later scan
+						if (!feedbackDeferred[id]) {
+							feedbackDeferred[id] = true;
+							if (sendOSCEndMessage > 0) sendOSCEndMessage--;
+						}
 					}
-				} break;
+					else if (stepParameterChange) {
+						// Send manually altered parameter change out to OSC
+						if (!isNprnVisible(nprn) && !oscOutput.snapshotting) hiddenFeedbackBudget--;
+						nprns[id].setValue(v, lastValueIn[id] < 0);
+						lastValueOut[id] = v;
+						processActivity = true;
+						oscSent = true;
+						sendOSCFeedback(id);
+                    	oscProcessResetParameter = false;
+                   		 // If we are broadcasting parameter updates when switching modules,
+                   		 // record that we have now sent this parameter
+                    	if (sendOSCEndMessage > 0 && !feedbackDeferred[id]) sendOSCEndMessage--;
+                    	feedbackDeferred[id] = false;
+                    }
+				}
+			} break;
 
-				case MIDIMODE::MIDIMODE_LOCATE: {
-					bool indicate = false;
-					if ((nprn >= 0 && nprns[id].getValue() >= 0) && lastValueInIndicate[id] != nprns[id].getValue()) {
-						lastValueInIndicate[id] = nprns[id].getValue();
-						indicate = true;
-					}
-					if (indicate) {
-						ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
-						paramHandles[id].indicate(mw);
-					}
-				} break;
-			}
+			case MIDIMODE::MIDIMODE_LOCATE: {
+				bool indicate = false;
+				if ((nprn >= 0 && nprns[id].getValue() >= 0) && lastValueInIndicate[id] != nprns[id].getValue()) {
+					lastValueInIndicate[id] = nprns[id].getValue();
+					indicate = true;
+				}
+				if (indicate) {
+					ModuleWidget* mw = APP->scene->rack->getModule(paramQuantity->module->id);
+					paramHandles[id].indicate(mw);
+				}
+			} break;
 		}
+	}
 
-		// Send end of mapping message, when switching between saved module mappings
-		// NB: Module parameters may get processed in multiple process() calls, so we need to wait until all the module parameters
-		// have been send to OSC before sending the final endChangeE1Module command to the OSC.
-        if (sendOSCEndMessage == 1) {
-          // Send end module mapping message to OSC
-          endChangeE1Module();
-          sendOSCEndMessage = 0;
+	/**
+	 * Handles the newest value of a /fader message
+	 * Returns true if the value differs from the last value received for the NPRN
+	 */
+	bool processFaderValue(int nprn, int value) {
+		if (nprn < 0 || nprn > MAX_NPRN_ID) return false;
+		if (learningId >= 0 && learnedNprnLast != nprn && valuesNprn[nprn] != value) {                    
+            nprns[learningId].setNprn(nprn);
+            nprns[learningId].nprnMode = NPRNMODE::DIRECT;
+            nprns[learningId].set14bit(true);
+            learnedNprn = true;
+            learnedNprnLast = nprn;
+            commitLearn();
+            updateMapLen();
+            refreshParamHandleText(learningId);
         }
+        bool changed = valuesNprn[nprn] != value;
+        // DEBUG("changed %d valuesNprn[nprn] %d value %d", changed, valuesNprn[nprn], value);
+        valuesNprn[nprn] = value;
+        valuesNprnTs[nprn] = ts;
+        controllerValues[nprn] = value;
+        markNprnDirty(nprn);
+		return changed;
+	}
+
+	/**
+	 * Handles /pylades/sync: compares the client's checksum of an NPRN range with our own and, if they differ,
+	 * re-sends the value and display text of every mapped control in that range.
+	 * Returns true if the range was out of sync.
+	 */
+	bool processSync(int seq, int firstNprn, int lastNprn, int checksum) {
+		firstNprn = clamp(firstNprn, 0, MAX_NPRN_ID);
+		lastNprn = clamp(lastNprn, 0, MAX_NPRN_ID);
+		controllerSyncs = true;
+		bool divergent = nprnSyncChecksum(controllerValues, firstNprn, lastNprn) != checksum;
+		if (divergent) {
+			for (int id = 0; id < mapLen; id++) {
+				int nprn = nprns[id].getNprn();
+				if (nprn < firstNprn || nprn > lastNprn) continue;
+				lastValueOut[id] = -1;
+				nprns[id].resetValue();
+				feedbackTexts.clearSent(id);
+			}
+		}
+		oscOutput.sendSyncAck(seq, divergent);
+		return divergent;
 	}
 
 	/**
@@ -866,75 +1218,93 @@ private:
 	 * ===============
 	 * []
 	 * 
+	 * /pylades/sync (re-sends the mapped parameters of an NPRN range only if the client's view has drifted)
+	 * =============
+	 * [0]		Sequence number, echoed in the /pylades/syncack reply (int)
+	 * [1]		First controller Id of the range (int)
+	 * [2]		Last controller Id of the range (int)
+	 * [3]		Checksum of the range as computed by nprnSyncChecksum() (int)
+	 * 
+	 * /pylades/page (control page shown by the client, feedback for the other pages is sent lazily)
+	 * =============
+	 * [0]		Page number, 1 to 6, or 0 if the client shows all pages (int)
+	 * 
+	 * /pylades/protocol (selects the feedback protocol revision, replied with /pylades/protocol and the revision used)
+	 * =================
+	 * [0]		Revision, 1 (default), 2 or 3 (int)
+	 * 
+	 * Revision 1 sends /fader/info [id, display value with unit, name] for every change. Revision 2 sends
+	 * /fader/value [id, display value] instead, and after each module switch, before /module/end, a metadata block:
+	 * /module/meta [hash, number of entries, controls per page], /module/meta/fader [id, name, unit] per mapped
+	 * control and /module/meta/end [hash]. The block is sent again if a label is edited. A client that has the
+	 * layout of a hash cached may ignore the entries. Revision 3 is revision 2 where the values and display texts
+	 * of a module switch are not sent one by one but together in /module/snapshot messages, see sendSnapshot(),
+	 * between the metadata block and /module/end.
+	 * 
 	 */ 
-	bool processOscMessage(TheModularMind::OscMessage msg) {
-
-		std::string address = msg.getAddress();
-
-		// DEBUG("OSC message %s", address.c_str());
-
-		if (address == OSCMSG_FADER) {
-			int nprn = msg.getArgAsInt(0);
-			int value = msg.getArgAsInt(1);
-			if (learningId >= 0 && learnedNprnLast != nprn && valuesNprn[nprn] != value) {                    
-	            nprns[learningId].setNprn(nprn);
-	            nprns[learningId].nprnMode = NPRNMODE::DIRECT;
-	            nprns[learningId].set14bit(true);
-	            learnedNprn = true;
-	            learnedNprnLast = nprn;
-	            commitLearn();
-	            updateMapLen();
-	            refreshParamHandleText(learningId);
-	        }
-	        oscReceived = valuesNprn[nprn] != value;
-	        // DEBUG("oscReceived %d valuesNprn[nprn] %d value %d", oscReceived, valuesNprn[nprn], value);
-	        valuesNprn[nprn] = value;
-	        valuesNprnTs[nprn] = ts;
-			return oscReceived;
-		} else if (address == OSCMSG_NEXT_MODULE) {
+	bool processOscMessage(const TheModularMind::OscInboundMessage& msg) {
+
+		// DEBUG("OSC message %s", msg.getAddress());
+
+		switch ((OSCCOMMAND)msg.getAddressId()) {
+		case OSCCOMMAND::FADER:
+			// Normally consumed from oscFaderTable, only arrives here if the message had non-numeric arguments
+			return processFaderValue(msg.getArgAsInt(0), msg.getArgAsInt(1));
+		case OSCCOMMAND::NEXT_MODULE:
 			// DEBUG("Received an OSC Next Command");
             oscProcessNext = true;
             return true;
-		} else if (address == OSCMSG_PREV_MODULE) {
+		case OSCCOMMAND::PREV_MODULE:
             // DEBUG("Received an OSC Prev Command");
             oscProcessNext = false;
             oscProcessPrev = true;
             return true;
-		} else if (address == OSCMSG_SELECT_MODULE) {
+		case OSCCOMMAND::SELECT_MODULE: {
             // DEBUG ("Received an OSC Module Select Command");
             oscProcessSelect = true;
             float moduleY = msg.getArgAsFloat(0);
             float moduleX = msg.getArgAsFloat(1);
             oscSelectedModulePos = Vec(moduleX, moduleY);
             return true;
-		} else if (address == OSCMSG_LIST_MODULES) {
+		}
+		case OSCCOMMAND::LIST_MODULES:
             // DEBUG("Received an OSC List Mapped Modules Command");
             oscProcessListMappedModules = true;
             return true;
-        } else if (address == OSCMSG_RESET_PARAM) {
+        case OSCCOMMAND::RESET_PARAM:
         	// DEBUG("Received an OSC Reset Parameter Command for id %d", oscProcessResetParameterNPRN);
  			oscProcessResetParameter = true;
             oscProcessResetParameterNPRN = msg.getArgAsInt(0);            
+            markNprnDirty(oscProcessResetParameterNPRN);
             return true;
-        } else if (address == OSCMSG_RESEND) {
+        case OSCCOMMAND::RESEND:
         	// DEBUG("Received an OSC Re-send OSC Feedback Command");
             oscProcessResendOSCFeedback = true;
             return true;
-        } else if (address == OSCMSG_APPLY_MODULE) {
+        case OSCCOMMAND::APPLY_MODULE:
         	// Remotely switch on the "apply" mode, so next mouse click will apply mapped settings for selected module
         	// DEBUG("Received an OSC Apply Module Command");
 	        oscProcessApply = true;
 	        return true;	
-        } else if (address == OSCMSG_APPLY_RACK_MAPPING) {
+        case OSCCOMMAND::APPLY_RACK_MAPPING:
         	// DEBUG("Received an OSC Apply Rack Mapping Command");
 	        oscProcessApplyRackMapping = true;
 	        return true;
-        } else if (address == OSCMSG_VERSION_POLL) {
+        case OSCCOMMAND::VERSION_POLL:
         	// DEBUG("Received an OSC Version Poll Command");
 	        oscVersionPoll = true;
 	        return true;
-		} else {
-			WARN("Discarding unknown OSC message. OSC message had address: %s and %i args", msg.getAddress().c_str(), (int)msg.getNumArgs());
+        case OSCCOMMAND::SYNC:
+        	// DEBUG("Received an OSC Sync Command");
+	        return processSync(msg.getArgAsInt(0), msg.getArgAsInt(1), msg.getArgAsInt(2), msg.getArgAsInt(3));
+        case OSCCOMMAND::PAGE:
+        	// DEBUG("Received an OSC Page Command");
+	        return setVisiblePage(msg.getArgAsInt(0));
+        case OSCCOMMAND::PROTOCOL:
+        	// DEBUG("Received an OSC Protocol Command");
+	        return setProtocolVersion(msg.getArgAsInt(0));
+		default:
+			WARN("Discarding unknown OSC message. OSC message had address: %s and %i args", msg.getAddress(), (int)msg.getNumArgs());
 			return false;
 		};
 
@@ -1011,13 +1381,165 @@ private:
 			lastValueOut[i] = -1;
 			nprns[i].resetValue();
 		}
+		// The display texts too, even those unchanged
+		feedbackTexts.clearSent();
 	}
 
 	void changeOSCModule(const char* moduleName, const char* moduleDisplayName, float moduleY, float moduleX, int maxNprnId, const std::array<std::string, MAX_PAGES>& pageLabels) {
 	    // DEBUG("changeOSCModule to %s", moduleName);
+	    // The client starts the new module with no known values, and so do we
+	    std::fill_n(controllerValues, MAX_NPRN_ID + 1, -1);
+	    // Resend all display texts for the new module, even those unchanged
+	    feedbackTexts.clearSent();
 	    oscOutput.changeOSCModule(moduleName, moduleDisplayName, moduleY, moduleX, maxNprnId, pageLabels);
 	}
 
+	/**
+	 * Sends the display texts formatted by the widget. Revision 1 clients get name, value and unit in every
+	 * /fader/info. Revision 2 clients get only the value in /fader/value, names and units go to the metadata
+	 * block, which is sent when the texts of a module switch are complete or after a label was edited.
+	 */
+	void processFeedbackTexts() {
+		// Kept queued while the sender is off, so no text is recorded as sent that the client never got
+		if (!sending) return;
+		if (!oscOutput.sendModuleChange()) return;
+		oscSender.beginBundle();
+		feedbackTexts.receive([this](const FeedbackTexts<MAX_CHANNELS>::Text& t, bool metaChanged, bool valueChanged) -> bool {
+			if (t.id < 0) {
+				// Marker behind the texts of a module switch
+				feedbackMarkerPending = false;
+				if (protocolVersion >= 2 && metadataChanged) sendMetadata();
+				if (oscOutput.snapshotting) sendSnapshot();
+				endChangeE1Module();
+				return true;
+			}
+			int nprn = nprns[t.id].getNprn();
+			if (nprn < 0) return true;
+			if (oscOutput.snapshotting) {
+				// Sent with the snapshot
+				if (metaChanged) metadataChanged = true;
+			}
+			else if (protocolVersion >= 2) {
+				if (valueChanged && !oscOutput.sendOscControlValue(nprn, t.value)) return false;
+				if (metaChanged) metadataChanged = true;
+			}
+			else {
+				char displayValue[FeedbackTexts<MAX_CHANNELS>::TEXT_LENGTH + FeedbackTexts<MAX_CHANNELS>::UNIT_LENGTH];
+				snprintf(displayValue, sizeof(displayValue), "%s %s", t.value, t.unit);
+				return oscOutput.sendOscControlUpdate(nprn, t.name, displayValue);
+			}
+			return true;
+		});
+		if (metadataChanged && !feedbackMarkerPending && sendOSCEndMessage == 0) sendMetadata();
+		oscSender.endBundle();
+	}
+
+	void requestAllFeedbackTexts() {
+		for (int id = 0; id < mapLen; id++) {
+			if (nprns[id].getNprn() >= 0) feedbackTexts.request(id);
+		}
+	}
+
+	/**
+	 * Hash of the metadata block, over controls per page and the controller id, name and unit of each entry.
+	 * Clients treat it as an opaque key. Also returns the number of entries.
+	 */
+	uint32_t metadataHash(int& count) {
+		uint8_t perPage = NPRNS_PER_PAGE;
+		uint32_t h = fnv1aHash(&perPage, 1);
+		count = 0;
+		for (int id = 0; id < mapLen; id++) {
+			int nprn = nprns[id].getNprn();
+			const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+			if (nprn < 0 || !t) continue;
+			uint8_t nprnBytes[2] = {(uint8_t)(nprn >> 8), (uint8_t)nprn};
+			h = fnv1aHash(nprnBytes, 2, h);
+			h = fnv1aHash(t->name, std::strlen(t->name) + 1, h);
+			h = fnv1aHash(t->unit, std::strlen(t->unit) + 1, h);
+			count++;
+		}
+		return h;
+	}
+
+	/** Sends the names and units of all mapped controls as one /module/meta block */
+	void sendMetadata() {
+		int count;
+		uint32_t hash = metadataHash(count);
+		bool sent = oscOutput.sendMetadataBegin(hash, count);
+		for (int id = 0; id < mapLen; id++) {
+			int nprn = nprns[id].getNprn();
+			const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+			if (nprn < 0 || !t) continue;
+			sent = oscOutput.sendMetadataFader(nprn, t->name, t->unit) && sent;
+		}
+		sent = oscOutput.sendMetadataEnd(hash) && sent;
+		// A block the sender dropped any part of is sent again whole
+		metadataChanged = !sent;
+	}
+
+	/**
+	 * Sends the value and display text of every mapped control, as recorded since the module switch, in
+	 * /module/snapshot [part, parts, blob] messages. The blob holds one entry per control: controller id and
+	 * value as 2 byte big endian integers, the length of the display text in 1 byte and the text. Entries are
+	 * split into as many parts as needed to keep each message within getMaxDatagramSize().
+	 */
+	void sendSnapshot() {
+		oscOutput.snapshotting = false;
+		// Room left by the bundle, message address and the other arguments
+		int limit = std::min(oscSender.getMaxDatagramSize(), (int)sizeof(snapshotBlob)) - 64;
+		int parts = 0;
+		if (nprnIndexDirty) rebuildNprnIndex();
+		// The first pass counts the parts, the second sends them
+		for (int pass = 0; pass < 2; pass++) {
+			int part = 0;
+			int size = 0;
+			for (int id = 0; id < mapLen; id++) {
+				int nprn = nprns[id].getNprn();
+				if (nprn < 0 || controllerValues[nprn] < 0) continue;
+				// One entry per control, from the first channel mapped to it
+				if (nprnChannelHead[nprn] != id) continue;
+				const FeedbackTexts<MAX_CHANNELS>::Text* t = feedbackTexts.getSent(id);
+				const char* text = t ? t->value : "";
+				int length = std::strlen(text);
+				if (size > 0 && size + 5 + length > limit) {
+					if (pass == 1) oscOutput.sendSnapshot(part, parts, snapshotBlob, size);
+					part++;
+					size = 0;
+				}
+				if (pass == 1) {
+					int value = controllerValues[nprn];
+					snapshotBlob[size] = nprn >> 8;
+					snapshotBlob[size + 1] = nprn & 0xFF;
+					snapshotBlob[size + 2] = value >> 8;
+					snapshotBlob[size + 3] = value & 0xFF;
+					snapshotBlob[size + 4] = length;
+					std::memcpy(snapshotBlob + size + 5, text, length);
+				}
+				size += 5 + length;
+			}
+			if (pass == 1) oscOutput.sendSnapshot(part, parts, snapshotBlob, size);
+			parts = part + 1;
+		}
+	}
+
+	/** Feedback protocol revision asked for by the client, replied with the revision used */
+	bool setProtocolVersion(int version) {
+		protocolVersion = clamp(version, 1, (int)PROTOCOL_VERSION);
+		metadataChanged = false;
+		oscOutput.snapshotting = false;
+		// Send all names and values again in the form of the new revision
+		oscResendFeedback();
+		if (protocolVersion >= 2) requestAllFeedbackTexts();
+		oscOutput.sendProtocolAck(protocolVersion);
+		return true;
+	}
+
+	/** UI thread. Sets the label of a channel and sends it to the client. */
+	void setTextLabel(int id, std::string label) {
+		textLabel[id] = label;
+		feedbackTexts.request(id);
+	}
+
 	void endChangeE1Module() {
 	    // DEBUG("endChangeE1Module");
 	    oscOutput.endChangeE1Module();
@@ -1054,6 +1576,40 @@ private:
         }
 	}
 
+	/**
+	 * Clears all mappings like clearMaps_WithLock(), then binds channels 0 .. count - 1 to the parameters in
+	 * moduleIds / paramIds. Rack gives plugins no way to hold the engine write lock over several handle
+	 * updates, so rather than a clear and a learnParam() per channel (two locks each) this updates only the
+	 * handles whose target changes, with one updateParamHandle() each. Returns the number of updates.
+	 */
+	int rebindMaps(const int64_t* moduleIds, const int* paramIds, int count) {
+		learningId = -1;
+		int updates = 0;
+		for (int id = 0; id < MAX_CHANNELS; id++) {
+			int64_t moduleId = id < count ? moduleIds[id] : -1;
+			int paramId = id < count ? paramIds[id] : 0;
+			nprns[id].reset();
+			textLabel[id] = "";
+			midiOptions[id] = 0;
+			rackParam[id].reset();
+			// Read from the handle itself, an earlier update may have taken its parameter away
+			if (paramHandles[id].moduleId != moduleId || (moduleId >= 0 && paramHandles[id].paramId != paramId)) {
+				APP->engine->updateParamHandle(&paramHandles[id], moduleId, paramId, true);
+				updates++;
+			}
+			refreshParamHandleText(id);
+		}
+		mapLen = 1;
+		expMemModuleId = -1;
+		if (count > 0) learnedParam = true;
+
+		for (int i = 0; i < MAX_PAGES; i++) {
+            pageLabels[i].clear();
+        }
+		updateMapLen();
+		return updates;
+	}
+
 	void clearMaps_NoLock() {
 		learningId = -1;
 		for (int id = 0; id < MAX_CHANNELS; id++) {
@@ -1208,6 +1764,7 @@ private:
      * Optionally skips modules which already have a mapping definition loaded into Pylades midiMap
      */
     void autoMapAllModules(bool skipPremappedModules) {
+		waitForMappingLibrary();
 
     	// Get snapshot of current state
 		json_t* currentStateJ = toJson();
@@ -1270,7 +1827,8 @@ private:
 	}
 
 	void expMemSave(std::string pluginSlug, std::string moduleSlug, bool autoMapped) {
-		MemModule* m = new MemModule;
+		waitForMappingLibrary();
+		MappingLibrary::Mapping m;
 		Module* module = NULL;
 		bool hasParameters = false;
 		for (size_t i = 0; i < MAX_CHANNELS; i++) {
@@ -1278,43 +1836,39 @@ private:
 			if (paramHandles[i].module->model->plugin->slug != pluginSlug && paramHandles[i].module->model->slug == moduleSlug) continue;
 			hasParameters = true;
 			module = paramHandles[i].module;
-			MemParam* p = new MemParam;
-			p->paramId = paramHandles[i].paramId;
-			p->nprn = nprns[i].getNprn();
-			p->nprnMode = nprns[i].nprnMode;
-			p->label = textLabel[i];
-			p->midiOptions = midiOptions[i];
-			p->slew = rackParam[i].getSlew();
-			p->min = rackParam[i].getMin();
-			p->max = rackParam[i].getMax();
-			m->paramMap.push_back(p);
+			MemParam p;
+			p.paramId = paramHandles[i].paramId;
+			p.nprn = nprns[i].getNprn();
+			p.nprnMode = nprns[i].nprnMode;
+			p.label = textLabel[i];
+			p.midiOptions = midiOptions[i];
+			p.slew = rackParam[i].getSlew();
+			p.min = rackParam[i].getMin();
+			p.max = rackParam[i].getMax();
+			m.params.push_back(p);
 		}
 
 		if (!hasParameters) return; // No mapped parameters, so do not add to map
 
-		m->pluginName = module->model->plugin->name;
-		m->moduleName = module->model->name;
-		m->autoMapped = autoMapped; // Manually saving module map, so assume is no longer considered auto-mapped
+		m.pluginName = module->model->plugin->name;
+		m.moduleName = module->model->name;
+		m.autoMapped = autoMapped; // Manually saving module map, so assume is no longer considered auto-mapped
 		for (size_t i = 0; i < MAX_PAGES; i++) {
-			m->pageLabels[i] = pageLabels[i];	
-		}
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it != midiMap.end()) {
-			delete it->second;
+			m.pageLabels[i] = pageLabels[i];	
 		}
-
-		(midiMap)[p] = m;
+		midiMap.update([&](MappingLibrary& lib) {
+			lib.set(pluginSlug, moduleSlug, m);
+		});
 	}
 
 	void expMemDelete(std::string pluginSlug, std::string moduleSlug) {
+		waitForMappingLibrary();
 		json_t* currentStateJ = toJson();
 
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it != midiMap.end()) {
-			delete it->second;
-			midiMap.erase(p);
+		if (midiMap.get()->find(pluginSlug, moduleSlug)) {
+			midiMap.update([&](MappingLibrary& lib) {
+				lib.erase(pluginSlug, moduleSlug);
+			});
 
 			// history::ModuleChange
 			history::ModuleChange* h = new history::ModuleChange;
@@ -1328,18 +1882,12 @@ private:
 
 	/* Delete all mapped modules belonging to same plugin, add to undo history */
 	void expMemPluginDelete(std::string pluginSlug) {
+		waitForMappingLibrary();
 		json_t* currentStateJ = toJson();
 
-		// From: https://stackoverflow.com/a/4600592
-		auto itr = midiMap.begin();
-		while (itr != midiMap.end()) {
-		    if (itr->first.first == pluginSlug) {
-		    	delete itr->second;
-		       	itr = midiMap.erase(itr);
-		    } else {
-		       ++itr;
-		    }
-		}
+		midiMap.update([&](MappingLibrary& lib) {
+			lib.erasePlugin(pluginSlug);
+		});
 
 		// history::ModuleChange
 		history::ModuleChange* h = new history::ModuleChange;
@@ -1353,9 +1901,12 @@ private:
 
     /* Delete all mapped modules, add to undo history */
     void expMemPluginDeleteAll() {
+        waitForMappingLibrary();
         json_t* currentStateJ = toJson();
 
-        resetMap();
+        midiMap.update([](MappingLibrary& lib) {
+            lib.clear();
+        });
 
         // history::ModuleChange
         history::ModuleChange* h = new history::ModuleChange;
@@ -1395,36 +1946,59 @@ private:
 
 	void expMemApply(Module* m, math::Vec pos = Vec(0,0)) {
 		if (!m) return;
-		auto p = std::pair<std::string, std::string>(m->model->plugin->slug, m->model->slug);
-		auto it = midiMap.find(p);
-		if (it == midiMap.end()) return;
-		MemModule* map = it->second;
+		if (libraryLoader.isLoading()) {
+			WARN("Mapping library is still loading, skipping the mapping of %s %s", m->model->plugin->slug.c_str(), m->model->slug.c_str());
+			return;
+		}
+		MappingLibraryCache::Snapshot lib = midiMap.get();
+		const MappingLibrary::Entry* entry = lib->find(m->model->plugin->slug, m->model->slug);
+		if (!entry) return;
+		// Decodes the mapping on its first use if the library was only indexed
+		MappingLibrary::Mapping& map = loadedMapping;
+		if (!lib->get(*entry, map)) {
+			WARN("Could not decode the mapping of %s %s", m->model->plugin->slug.c_str(), m->model->slug.c_str());
+			return;
+		}
+		const std::vector<MemParam>& params = map.params;
+		int64_t switchStart = system::getNanoseconds();
 
         // Send message to E1 to prep for new mappings before new values sent
         int maxNprnId = 0;
-        for (MemParam* it : map->paramMap) {
-        	if (it->nprn > maxNprnId) {
-        		maxNprnId = it->nprn;
+        for (const MemParam& it : params) {
+        	if (it.nprn > maxNprnId) {
+        		maxNprnId = it.nprn;
         	}
         }
-		changeOSCModule(m->model->name.c_str(), m->model->getFullName().c_str(), pos.y, pos.x, maxNprnId, map->pageLabels);
-
-		clearMaps_WithLock();
+		changeOSCModule(m->model->name.c_str(), m->model->getFullName().c_str(), pos.y, pos.x, maxNprnId, map.pageLabels);
+
+		// Bind the param handles of the new mapping up front, in as few engine locks as possible
+		int64_t moduleIds[MAX_CHANNELS];
+		int paramIds[MAX_CHANNELS];
+		int count = 0;
+		for (const MemParam& it : params) {
+			if (count >= MAX_CHANNELS) break;
+			moduleIds[count] = m->id;
+			paramIds[count] = it.paramId;
+			count++;
+		}
+		lastSwitchHandleUpdates = rebindMaps(moduleIds, paramIds, count);
 		oscOutput.reset();
 
 		expMemModuleId = m->id;
 		int i = 0;
 		sendOSCEndMessage = 1;
-		for (MemParam* it : map->paramMap) {
-			learnParam(i, m->id, it->paramId);
-			nprns[i].setNprn(it->nprn);
-			nprns[i].nprnMode = it->nprnMode;
+		std::fill_n(feedbackDeferred, MAX_CHANNELS, false);
+		// Revision 3 sends the values and texts of the new mapping together in one snapshot
+		oscOutput.snapshotting = protocolVersion >= 3;
+		for (const MemParam& it : params) {
+			nprns[i].setNprn(it.nprn);
+			nprns[i].nprnMode = it.nprnMode;
 			nprns[i].set14bit(true);
-			textLabel[i] = it->label;
-			midiOptions[i] = it->midiOptions;
-			rackParam[i].setSlew(it->slew);
-			rackParam[i].setMin(it->min);
-			rackParam[i].setMax(it->max);
+			textLabel[i] = it.label;
+			midiOptions[i] = it.midiOptions;
+			rackParam[i].setSlew(it.slew);
+			rackParam[i].setMin(it.min);
+			rackParam[i].setMax(it.max);
 			// Force next processMappings() call to process all mappings after module controls have been switched
 			lastValueOut[i] = -1;
 
@@ -1435,16 +2009,22 @@ private:
 			i++;
 		}
 		for (int i = 0; i < MAX_PAGES; i++) {
-			pageLabels[i] = map->pageLabels[i];
+			pageLabels[i] = map.pageLabels[i];
 		}
 
 		updateMapLen();
+		// Don't wait for the next scan to collect the new mapping
+		scanRequested = true;
+
+		lastSwitchUs = (system::getNanoseconds() - switchStart) / 1000;
+		DEBUG("Module switch took %lld µs, %d param handle updates", (long long)lastSwitchUs, lastSwitchHandleUpdates);
 
 	}
 
 	void expMemApplyRackMapping() {
 
 		if (rackMapping.paramMap.empty()) return;
+		int64_t switchStart = system::getNanoseconds();
 
 		// Send message to E1 to prep for new rack mappings before new values sent
         int maxNprnId = 0;
@@ -1454,14 +2034,25 @@ private:
         	}
         }
 		changeOSCModule("RackMapping", "Rack Mapping", 0, 0, maxNprnId, rackMapping.pageLabels);
-		clearMaps_WithLock();
+		int64_t moduleIds[MAX_CHANNELS];
+		int paramIds[MAX_CHANNELS];
+		int count = 0;
+		for (MemParam* it : rackMapping.paramMap) {
+			if (count >= MAX_CHANNELS) break;
+			moduleIds[count] = it->moduleId;
+			paramIds[count] = it->paramId;
+			count++;
+		}
+		lastSwitchHandleUpdates = rebindMaps(moduleIds, paramIds, count);
 		oscOutput.reset();
 		expMemModuleId = -1;
 
 		int i = 0;
 		sendOSCEndMessage = 1;
+		std::fill_n(feedbackDeferred, MAX_CHANNELS, false);
+		// Revision 3 sends the values and texts of the new mapping together in one snapshot
+		oscOutput.snapshotting = protocolVersion >= 3;
 		for (MemParam* it : rackMapping.paramMap) {
-			learnParam(i,it->moduleId, it->paramId);
 			nprns[i].setNprn(it->nprn);
 			nprns[i].nprnMode = it->nprnMode;
 			nprns[i].set14bit(true);
@@ -1484,6 +2075,11 @@ private:
 		}
 
 		updateMapLen();
+		// Don't wait for the next scan to collect the new mapping
+		scanRequested = true;
+
+		lastSwitchUs = (system::getNanoseconds() - switchStart) / 1000;
+		DEBUG("Module switch took %lld µs, %d param handle updates", (long long)lastSwitchUs, lastSwitchHandleUpdates);
 
 	}
 
@@ -1519,16 +2115,8 @@ private:
 		json_object_set_new(rootJ, "plugin", json_string(this->model->plugin->slug.c_str()));
 		json_t* dataJ = json_object();
 
-		// Get map of all mapped modules for this plugin
-		std::map<std::pair<std::string, std::string>, MemModule*> pluginMap;
-
-		pluginMap.clear();
-		for (auto it : midiMap) {
-			if (it.first.first == pluginSlug)
-				pluginMap[it.first] = it.second;
-		}
-
-		json_t* midiMapJ = midiMapToJsonArray(pluginMap);
+		// Only the mapped modules of this plugin
+		json_t* midiMapJ = midiMapToJsonArray(*midiMap.get(), pluginSlug);
 
 		json_object_set_new(dataJ, "midiMap", midiMapJ);
 		json_object_set_new(rootJ, "data", dataJ);
@@ -1556,10 +2144,9 @@ private:
 		return findModuleInMidiMap(m->model->plugin->slug, m->model->slug);
 	}
 	bool findModuleInMidiMap(std::string pluginSlug, std::string moduleSlug) {
-		auto p = std::pair<std::string, std::string>(pluginSlug, moduleSlug);
-		auto it = midiMap.find(p);
-		if (it == midiMap.end()) return false;
-		return true;
+		// Nothing counts as mapped until the library has loaded
+		if (libraryLoader.isLoading()) return false;
+		return midiMap.get()->find(pluginSlug, moduleSlug) != NULL;
 	}
 
 	/**
@@ -1567,6 +2154,7 @@ private:
 	 * overwriting existing file contents
 	 */ 
 	void expMemSaveLibrary(bool force = false) {
+		waitForMappingLibrary();
 
 		if (midiMapLibraryFilename.empty()) {
 			return;
@@ -1595,7 +2183,11 @@ private:
 		json_object_set_new(rootJ, "textScrolling", json_boolean(textScrolling));
 		json_object_set_new(rootJ, "mappingIndicatorHidden", json_boolean(mappingIndicatorHidden));
 		json_object_set_new(rootJ, "locked", json_boolean(locked));
-		json_object_set_new(rootJ, "processDivision", json_integer(processDivision));
+		json_object_set_new(rootJ, "processInterval", json_integer(processInterval));
+		json_object_set_new(rootJ, "processAdaptive", json_boolean(processAdaptive));
+		json_object_set_new(rootJ, "processIntervalMin", json_integer(processIntervalMin));
+		json_object_set_new(rootJ, "processIntervalMax", json_integer(processIntervalMax));
+		json_object_set_new(rootJ, "oscMaxDatagramSize", json_integer(oscMaxDatagramSize));
 		json_object_set_new(rootJ, "overlayEnabled", json_boolean(overlayEnabled));
 		json_object_set_new(rootJ, "clearMapsOnLoad", json_boolean(clearMapsOnLoad));
 		json_object_set_new(rootJ, "scrollToModule", json_boolean(scrollToModule));
@@ -1668,33 +2260,42 @@ private:
 		return rootJ;
 	}
 
-	json_t* midiMapToJsonArray(std::map<std::pair<std::string, std::string>, MemModule*>& aMidiMap) {
+	/**
+	 * Mapping library as JSON, ordered by plugin and module slug. Only the modules of pluginSlug, unless it is empty.
+	 * Any thread.
+	 */
+	json_t* midiMapToJsonArray(const MappingLibrary& lib, const std::string& pluginSlug = "") {
 		json_t* midiMapJ = json_array();
-		for (auto it : aMidiMap) {
+		MappingLibrary::Mapping m;
+		for (const MappingLibrary::Entry* a : lib.sorted()) {
+			if (!pluginSlug.empty() && lib.str(a->pluginSlug) != pluginSlug) continue;
+			if (!lib.get(*a, m)) {
+				WARN("Could not decode the mapping of %s %s, skipping", lib.str(a->pluginSlug).c_str(), lib.str(a->moduleSlug).c_str());
+				continue;
+			}
 			json_t* midiMapJJ = json_object();
-			json_object_set_new(midiMapJJ, "ps", json_string(it.first.first.c_str())); // pluginSlug
-			json_object_set_new(midiMapJJ, "ms", json_string(it.first.second.c_str())); // moduleSlug
-			auto a = it.second;
-			json_object_set_new(midiMapJJ, "am", json_boolean(a->autoMapped)); // autoMapped
-			json_object_set_new(midiMapJJ, "pn", json_string(a->pluginName.c_str())); // pluginName
-			json_object_set_new(midiMapJJ, "mn", json_string(a->moduleName.c_str())); // moduleName
+			json_object_set_new(midiMapJJ, "ps", json_string(lib.str(a->pluginSlug).c_str())); // pluginSlug
+			json_object_set_new(midiMapJJ, "ms", json_string(lib.str(a->moduleSlug).c_str())); // moduleSlug
+			json_object_set_new(midiMapJJ, "am", json_boolean(m.autoMapped)); // autoMapped
+			json_object_set_new(midiMapJJ, "pn", json_string(m.pluginName.c_str())); // pluginName
+			json_object_set_new(midiMapJJ, "mn", json_string(m.moduleName.c_str())); // moduleName
 			json_t* paramMapJ = json_array();
-			for (auto p : a->paramMap) {
+			for (const MemParam& p : m.params) {
 				json_t* paramMapJJ = json_object();
-				json_object_set_new(paramMapJJ, "p", json_integer(p->paramId));
-				json_object_set_new(paramMapJJ, "n", json_integer(p->nprn));
-				json_object_set_new(paramMapJJ, "nm", json_integer((int)p->nprnMode));
-				json_object_set_new(paramMapJJ, "l", json_string(p->label.c_str()));
-				json_object_set_new(paramMapJJ, "o", json_integer(p->midiOptions));
-				json_object_set_new(paramMapJJ, "s", json_real(p->slew));
-				json_object_set_new(paramMapJJ, "m", json_real(p->min));
-				json_object_set_new(paramMapJJ, "x", json_real(p->max));
+				json_object_set_new(paramMapJJ, "p", json_integer(p.paramId));
+				json_object_set_new(paramMapJJ, "n", json_integer(p.nprn));
+				json_object_set_new(paramMapJJ, "nm", json_integer((int)p.nprnMode));
+				json_object_set_new(paramMapJJ, "l", json_string(p.label.c_str()));
+				json_object_set_new(paramMapJJ, "o", json_integer(p.midiOptions));
+				json_object_set_new(paramMapJJ, "s", json_real(p.slew));
+				json_object_set_new(paramMapJJ, "m", json_real(p.min));
+				json_object_set_new(paramMapJJ, "x", json_real(p.max));
 				json_array_append_new(paramMapJ, paramMapJJ);
 			}
 			json_object_set_new(midiMapJJ, "pm", paramMapJ); // paramMap
 			json_t* pageLabelsJ = json_array();
 			for (int page = 0; page < MAX_PAGES; page++) {
-				json_array_append_new(pageLabelsJ, json_string(a->pageLabels[page].c_str()));
+				json_array_append_new(pageLabelsJ, json_string(m.pageLabels[page].c_str()));
 			}
 			json_object_set_new(midiMapJJ, "pl", pageLabelsJ);
 			json_array_append_new(midiMapJ, midiMapJJ);
@@ -1712,8 +2313,18 @@ private:
 		if (mappingIndicatorHiddenJ) mappingIndicatorHidden = json_boolean_value(mappingIndicatorHiddenJ);
 		json_t* lockedJ = json_object_get(rootJ, "locked");
 		if (lockedJ) locked = json_boolean_value(lockedJ);
+		json_t* processAdaptiveJ = json_object_get(rootJ, "processAdaptive");
+		if (processAdaptiveJ) processAdaptive = json_boolean_value(processAdaptiveJ);
+		json_t* processIntervalMinJ = json_object_get(rootJ, "processIntervalMin");
+		json_t* processIntervalMaxJ = json_object_get(rootJ, "processIntervalMax");
+		if (processIntervalMinJ && processIntervalMaxJ) setProcessIntervalLimits(json_integer_value(processIntervalMinJ), json_integer_value(processIntervalMaxJ));
+		json_t* processIntervalJ = json_object_get(rootJ, "processInterval");
+		if (processIntervalJ) setProcessInterval(json_integer_value(processIntervalJ));
+		// Older patches store the interval in samples at 44.1 kHz
 		json_t* processDivisionJ = json_object_get(rootJ, "processDivision");
-		if (processDivisionJ) setProcessDivision(json_integer_value(processDivisionJ));
+		if (!processIntervalJ && processDivisionJ) setProcessInterval((int)std::lround(json_integer_value(processDivisionJ) * 1000.0 / 44100.0));
+		json_t* oscMaxDatagramSizeJ = json_object_get(rootJ, "oscMaxDatagramSize");
+		if (oscMaxDatagramSizeJ) setOscMaxDatagramSize(json_integer_value(oscMaxDatagramSizeJ));
 		json_t* overlayEnabledJ = json_object_get(rootJ, "overlayEnabled");
 		if (overlayEnabledJ) overlayEnabled = json_boolean_value(overlayEnabledJ);
 		json_t* clearMapsOnLoadJ = json_object_get(rootJ, "clearMapsOnLoad");
@@ -1852,60 +2463,59 @@ private:
 		json_t* autosaveMappingLibraryJ = json_object_get(rootJ, "autosaveMidiMapLibrary");
 		if (autosaveMappingLibraryJ) autosaveMappingLibrary = json_boolean_value(autosaveMappingLibraryJ);
 
-		// Try to read and load the  module midimap library from the saved file location from the saved JSON
-		bool midiMapLoaded = false;
+		// Load the module midimap library from the saved file location from the saved JSON, off the engine thread
 		json_t* midiMapLibraryFilenameJ = json_object_get(rootJ, "midiMapLibraryFilename");
 		if (midiMapLibraryFilenameJ) {
-
 			midiMapLibraryFilename = json_string_value(midiMapLibraryFilenameJ);
-
-			// Load library data from file into json
-			if (!midiMapLibraryFilename.empty()) {
-				if (readMappingLibraryFile(midiMapLibraryFilename)) midiMapLoaded = true;
-			} else {
-				midiMapLoaded = loadDefaultMappingLibraryFromPresetFolder();
-			}
+			loadMappingLibrary();
 		} else {
 			WARN("No midimap library filename set");
+			// No library file in the saved state, so load the factory mapping library
+			loadMappingLibrary(false);
 		}
-
-		// No loaded midimap library file either from Pylades state or loaded preset
-		// So try and load default factory mapping library
-		if (!midiMapLoaded) {
-			createMappingLibraryFromFactory();
-		}
-			
 	}
 
-	bool loadDefaultMappingLibraryFromPresetFolder() {
-		// If there is a default library file in the user presets, load that anyway
-		std::string userPresetPath = this->model->getUserPresetDirectory();
-		midiMapLibraryFilename = system::join(userPresetPath, DEFAULT_LIBRARY_FILENAME);
-
-		if (system::exists(midiMapLibraryFilename)) {
-			return readMappingLibraryFile(midiMapLibraryFilename);
-		}
-		return false;	
-
-	}
-
-	void createMappingLibraryFromFactory() {
-
-		if (loadMidiMapFromFactoryLibraryFile()) {
-			// factory library loaded OK, now save copy of factory midimap to user preset folder if there is not already one in there
-
-			std::string userPresetPath = this->model->getUserPresetDirectory();
-			std::string defaultMidiMapLibraryFilename = system::join(userPresetPath, DEFAULT_LIBRARY_FILENAME);
-			INFO("Factory library loaded, saving to preset library %s", defaultMidiMapLibraryFilename.c_str() );
-			if (!system::exists(midiMapLibraryFilename)) {
-				system::createDirectories(userPresetPath); // NB: no-op if model preset folder already exists
-				midiMapLibraryFilename = defaultMidiMapLibraryFilename;
-				saveMappingLibraryFile(defaultMidiMapLibraryFilename);
-			} 
-		}
+	/**
+	 * Loads the library file midiMapLibraryFilename, or the default library file in the user presets if it is empty.
+	 * Falls back to the factory library, which is saved as the default library file if there is no library file.
+	 * The file I/O runs on the loader thread, and the module switches to the library once it is loaded.
+	 */
+	void loadMappingLibrary(bool readLibrary = true) {
+		std::string defaultLibraryFilename = system::join(this->model->getUserPresetDirectory(), DEFAULT_LIBRARY_FILENAME);
+		if (midiMapLibraryFilename.empty()) midiMapLibraryFilename = defaultLibraryFilename;
+		readLibrary = readLibrary && system::exists(midiMapLibraryFilename);
+		bool saveFactory = !system::exists(midiMapLibraryFilename);
+		if (saveFactory) midiMapLibraryFilename = defaultLibraryFilename;
+
+		std::string filename = midiMapLibraryFilename;
+		libraryLoader.load([this, filename, readLibrary, saveFactory](int generation) {
+			int64_t loadStart = system::getNanoseconds();
+			SharedMappingLibrary loaded;
+			bool ok = readLibrary && readMappingLibraryFile(filename, loaded);
+			if (!ok && loadMidiMapFromFactoryLibraryFile(loaded)) {
+				ok = true;
+				if (saveFactory) {
+					// factory library loaded OK, now save copy of factory midimap to user preset folder
+					INFO("Factory library loaded, saving to preset library %s", filename.c_str());
+					system::createDirectories(system::getDirectory(filename)); // NB: no-op if model preset folder already exists
+					if (writeMappingLibraryFile(filename, *loaded.get())) readMappingLibraryFile(filename, loaded);
+				}
+			}
+			if (!ok) return;
+
+			bool published = libraryLoader.publish(generation, [&]() {
+				midiMap.assign(loaded);
+			});
+			double loadMs = (system::getNanoseconds() - loadStart) / 1e6;
+			if (published) {
+				INFO("Loaded mapping library %s in %.1f ms", loaded.getPath().c_str(), loadMs);
+			} else {
+				INFO("Loaded mapping library %s in %.1f ms, dropped as another load was started", loaded.getPath().c_str(), loadMs);
+			}
+		});
 	}
 
-	bool loadMidiMapFromFactoryLibraryFile() {
+	bool loadMidiMapFromFactoryLibraryFile(SharedMappingLibrary& target) {
 		// Load factory default library
 		// It is stored in the RSBATechModules plugin presets folder
 		std::string factoryLibraryFilename = asset::plugin(this->model->plugin, system::join("presets", FACTORY_LIBRARY_FILENAME));
@@ -1915,152 +2525,60 @@ private:
 			return false;
 		}
 		
-		FILE* file = fopen(factoryLibraryFilename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load factory library file %s, skipping", factoryLibraryFilename.c_str());
-			return false;
-		}
-		DEFER({
-			fclose(file);
+		std::string pluginSlug = this->model->plugin->slug;
+		bool loaded = target.open(factoryLibraryFilename, [&](MappingLibrary& lib) {
+			return lib.loadIndex(factoryLibraryFilename, pluginSlug);
 		});
-
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		DEFER({
-			json_decref(libraryJ);
-		});
-
-		if (!libraryJ) {
-			WARN("Factory library file is not a valid JSON file. Parsing error at %s %d:%d %s, skipping", error.source, error.line, error.column, error.text);
-			return false;
-		}
-	
-		if (loadMidiMapFromLibrary(libraryJ)) {
-			INFO("Loaded factory library file %s", factoryLibraryFilename.c_str());
-			return true;
-		} else {
+		if (!loaded) {
+			WARN("Factory library file %s is not a valid mapping library file, skipping", factoryLibraryFilename.c_str());
 			return false;
 		}
-
-
-	}
-
-
-	bool readMappingLibraryFile(std::string filename) {
-
-		// DEBUG ("Reading mapping library file at %s", filename.c_str());
-		FILE* file = fopen(filename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load mapping library file %s", filename.c_str());
-			return false;
-		}
-		DEFER({
-			fclose(file);
-		});
-
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		DEFER ({
-			json_decref(libraryJ);
-		});
-
-		if (!libraryJ) {
-			WARN("File is not a valid JSON file. Parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
-			return false;
-		}
-		return loadMidiMapFromLibrary(libraryJ);
-		
-	}
-
-	/**
-	 * Replaces internal midiMap from selected mapping library file
-	 * 
-	 * Mutates the currentStateJ with the loaded midiMap list
-	 */
-	bool loadMidiMapFromLibrary(json_t* libraryJ) {
-
-		json_t* pluginJ = json_object_get(libraryJ, "plugin");
-        if (!pluginJ) return false;
-
-		std::string pluginSlug = json_string_value(pluginJ);
-		// Only handle midimap library JSON files created by RSBATechModule
-		if (!(pluginSlug == this->model->plugin->slug))
-			return false;
-
-		// Get the midiMap in the imported library Json
-		json_t* dataJ = json_object_get(libraryJ, "data");
-		json_t* midiMapJ = json_object_get(dataJ, "midiMap");
-		
-		// Load libray file midiMap into internal midiMap state
-		midiMapJSONArrayToMidiMap(midiMapJ);
-
-		// DEBUG("Loaded midiMap with %d", (int)midiMap.size());
-
+		INFO("Loaded factory library file %s", factoryLibraryFilename.c_str());
 		return true;
 	}
 
+
 	/**
-	 * Replaces internal midiMap with contents of a midiMap JSON array
+	 * Switches to the mapping library of a file, shared with the other instances using it. The file is only loaded
+	 * if no instance has it loaded yet, or it changed since.
 	 */
-	void midiMapJSONArrayToMidiMap(json_t* midiMapJ) {
-
-		resetMap();
-		size_t i;
-		json_t* midiMapJJ;
-		json_array_foreach(midiMapJ, i, midiMapJJ) {
-			midiMapJSONToMidiMap(midiMapJJ);
-		}
+	bool readMappingLibraryFile(std::string filename) {
+		waitForMappingLibrary();
+		return readMappingLibraryFile(filename, midiMap);
 	}
 
-	void midiMapJSONToMidiMap(json_t* midiMapJJ) {
-		std::string pluginSlug = json_string_value(json_object_get(midiMapJJ, "ps")); // pluginSlug
-		std::string moduleSlug = json_string_value(json_object_get(midiMapJJ, "ms")); // moduleSlug
+	/** Switches target to the mapping library of a file. Any thread. */
+	bool readMappingLibraryFile(const std::string& filename, SharedMappingLibrary& target) {
+		std::string pluginSlug = this->model->plugin->slug;
+		bool loaded = target.open(filename, [&](MappingLibrary& lib) {
+			// Map the binary image of the library if it is up to date, rather than reading the JSON
+			MappingLibrary::SourceKey key;
+			if (MappingLibrary::getSourceKey(filename, key) && lib.loadImage(filename + LIBRARY_IMAGE_EXTENSION, filename, key)) {
+				INFO("Loaded mapping library image of %s: %d modules", filename.c_str(), lib.size());
+				return true;
+			}
 
-		MemModule* a = new MemModule;
-		a->pluginName = json_string_value(json_object_get(midiMapJJ, "pn")); // pluginName
-		a->moduleName = json_string_value(json_object_get(midiMapJJ, "mn")); // moduleName
-		json_t* autoMappedJ = json_object_get(midiMapJJ, "am"); // autoMapped
-		if (autoMappedJ) {
-			a->autoMapped = json_boolean_value(autoMappedJ);
-		} else {
-			a->autoMapped = false; // default
-		}
-		json_t* paramMapJ = json_object_get(midiMapJJ, "pm"); // paramMap
-		size_t j;
-		json_t* paramMapJJ;
-		json_array_foreach(paramMapJ, j, paramMapJJ) {
-			MemParam* p = new MemParam;
-			p->paramId = json_integer_value(json_object_get(paramMapJJ, "p")); // paramId
-			p->nprn = json_integer_value(json_object_get(paramMapJJ, "n")); // nprnId
-			p->nprnMode = (NPRNMODE)json_integer_value(json_object_get(paramMapJJ, "nm")); // nprnMode
-			p->label = json_string_value(json_object_get(paramMapJJ, "l")); // label
-			p->midiOptions = json_integer_value(json_object_get(paramMapJJ, "o")); // midiOptions
-			json_t* slewJ = json_object_get(paramMapJJ, "s"); // slew
-			if (slewJ) p->slew = json_real_value(slewJ);
-			json_t* minJ = json_object_get(paramMapJJ, "m"); // min
-			if (minJ) p->min = json_real_value(minJ);
-			json_t* maxJ = json_object_get(paramMapJJ, "x"); // max
-			if (maxJ) p->max = json_real_value(maxJ);
-			a->paramMap.push_back(p);
-
-		}
-		json_t* pageLabelsJ = json_object_get(midiMapJJ, "pl");
-		if (pageLabelsJ) {
-			json_t* pageLabelJ;
-			size_t pageLabelsIndex;
-			json_array_foreach(pageLabelsJ, pageLabelsIndex, pageLabelJ) {
-				if (pageLabelsIndex >= MAX_PAGES) continue;
-				a->pageLabels[pageLabelsIndex] = json_string_value(pageLabelJ);
+			// Index the modules of the library, each is decoded when it is first used
+			if (!lib.loadIndex(filename, pluginSlug)) return false;
+			INFO("Indexed mapping library %s: %d modules", filename.c_str(), lib.size());
+			if (!MappingLibrary::getSourceKey(filename, key) || !lib.saveImage(filename + LIBRARY_IMAGE_EXTENSION, key)) {
+				WARN("Could not write mapping library image for %s", filename.c_str());
 			}
+			return true;
+		});
+		if (!loaded) {
+			WARN("File %s is not a valid mapping library file", filename.c_str());
+			return false;
 		}
-
-		midiMap[std::pair<std::string, std::string>(pluginSlug, moduleSlug)] = a;
+		DEBUG("Mapping library %s is used by %ld instances", filename.c_str(), target.getUseCount());
+		return true;
 	}
 
 	/**
-	 * Co-ordinates saving internal midimap state as a mapping library json file
+	 * Writes a mapping library as a mapping library json file, and its binary image beside it so the next load
+	 * can map the image instead of parsing the file. Any thread.
 	 */
-	bool saveMappingLibraryFile(std::string filename) {
+	bool writeMappingLibraryFile(const std::string& filename, const MappingLibrary& lib) {
 
 		INFO ("Saving mapping library to %s", filename.c_str());
 		json_t* rootJ = json_object();
@@ -2070,38 +2588,98 @@ private:
 
 		json_object_set_new(rootJ, "plugin", json_string(this->model->plugin->slug.c_str()));
 		json_t* dataJ = json_object();
-		json_t* midiMapJ = midiMapToJsonArray(midiMap);
+		json_t* midiMapJ = midiMapToJsonArray(lib);
 
 		json_object_set_new(dataJ, "midiMap", midiMapJ);
 		json_object_set_new(rootJ, "data", dataJ);
 
-		// Write to json file
-		FILE* file = fopen(filename.c_str(), "w");
-		if (!file) {
-			WARN("Could not open mapping library file for writing %s", filename.c_str());
+		// Write to a json file beside it and rename that over the old one, which a loaded library may still be
+		// decoding modules from
+		std::string tmpFilename = filename + ".tmp";
+		{
+			FILE* file = fopen(tmpFilename.c_str(), "w");
+			if (!file) {
+				WARN("Could not open mapping library file for writing %s", tmpFilename.c_str());
+				return false;
+			}
+
+			// Save midimap library JSON in a relatively compact form.
+			// Assume can be expanded in text editors if anyone needs to read and edit them directly.
+			bool written = json_dumpf(rootJ, file, 0) >= 0;
+			if (fclose(file) != 0) written = false;
+			if (!written) {
+				WARN("Could not write mapping library file %s", tmpFilename.c_str());
+				std::remove(tmpFilename.c_str());
+				return false;
+			}
+		}
+#if defined ARCH_WIN
+		// rename() does not replace existing files on Windows
+		std::remove(filename.c_str());
+#endif
+		if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+			WARN("Could not replace mapping library file %s", filename.c_str());
+			std::remove(tmpFilename.c_str());
 			return false;
 		}
-		DEFER({
-			fclose(file);
-		});
 
-        // Save midimap library JSON in a relatively compact form.
-        // Assume can be expanded in text editors if anyone needs to read and edit them directly.
-		if (json_dumpf(rootJ, file, 0) < 0) {
+		// The file is closed, so the image is keyed on its final size and modification time
+		MappingLibrary::SourceKey key;
+		if (!MappingLibrary::getSourceKey(filename, key) || !lib.saveImage(filename + LIBRARY_IMAGE_EXTENSION, key)) {
+			WARN("Could not write mapping library image for %s", filename.c_str());
+		}
+		return true;
+	}
+
+	/**
+	 * Co-ordinates saving internal midimap state as a mapping library json file
+	 */
+	bool saveMappingLibraryFile(std::string filename) {
+		if (!writeMappingLibraryFile(filename, *midiMap.get())) {
 			std::string message = string::f("File could not be written to %s", filename.c_str());
 			osdialog_message(OSDIALOG_ERROR, OSDIALOG_OK, message.c_str());
 			return false;
 		}
-
+		// Share the library of the saved file from now on. The file changed, so the instances already sharing it
+		// reload it from the new file and image too.
+		readMappingLibraryFile(filename);
 		return true;
 	}
 
-	void setProcessDivision(int d) {
-		processDivision = d;
-		processDivider.setDivision(d);
+	void setOscMaxDatagramSize(int size) {
+		oscSender.setMaxDatagramSize(size);
+		oscMaxDatagramSize = oscSender.getMaxDatagramSize();
+	}
+
+	void setProcessInterval(int ms) {
+		processInterval = std::max(1, ms);
+		setProcessIntervalCurrent(processAdaptive ? processIntervalMin : processInterval);
+	}
+
+	void setProcessAdaptive(bool adaptive) {
+		processAdaptive = adaptive;
+		setProcessInterval(processInterval);
+	}
+
+	void setProcessIntervalLimits(int min, int max) {
+		processIntervalMin = std::max(1, min);
+		processIntervalMax = std::max(processIntervalMin, max);
+		setProcessInterval(processInterval);
+	}
+
+	void setProcessIntervalCurrent(int ms) {
+		processIntervalCurrent = ms;
+		processDivider.setDivision(ms);
 		processDivider.reset();
 	}
 
+	/** Adaptive mode, after each scan: fastest rate while there is activity, else halve the rate down to the slowest */
+	void adaptProcessInterval() {
+		int ms = processActivity ? processIntervalMin : std::min(processIntervalCurrent * 2, processIntervalMax);
+		processActivity = false;
+		if (ms != processIntervalCurrent) setProcessIntervalCurrent(ms);
+	}
+
 	void setMode(MIDIMODE midiMode) {
 		if (this->midiMode == midiMode)
 			return;
@@ -10,20 +10,72 @@ namespace Pylades {
 
 static const std::string RXPORT_DEFAULT = "8881";
 static const std::string TXPORT_DEFAULT = "8880";
-static const std::string OSCMSG_FADER = "/fader";
-static const std::string OSCMSG_MODULE_START = "/pylades/moduleMeowMory/start";
-static const std::string OSCMSG_MODULE_END = "/pylades/moduleMeowMory/end";
-static const std::string OSCMSG_PREV_MODULE = "/pylades/prev";
-static const std::string OSCMSG_NEXT_MODULE = "/pylades/next";
-static const std::string OSCMSG_SELECT_MODULE = "/pylades/select";
-static const std::string OSCMSG_LIST_MODULES = "/pylades/listmodules";
-static const std::string OSCMSG_RESET_PARAM = "/pylades/resetparam";
-static const std::string OSCMSG_RESEND = "/pylades/resend";
-static const std::string OSCMSG_APPLY_MODULE = "/pylades/apply/modulemapping";
-static const std::string OSCMSG_APPLY_RACK_MAPPING = "/pylades/apply/rackmapping";
-static const std::string OSCMSG_VERSION_POLL = "/pylades/version";
+static constexpr const char* OSCMSG_FADER = "/fader";
+static constexpr const char* OSCMSG_MODULE_START = "/pylades/moduleMeowMory/start";
+static constexpr const char* OSCMSG_MODULE_END = "/pylades/moduleMeowMory/end";
+static constexpr const char* OSCMSG_PREV_MODULE = "/pylades/prev";
+static constexpr const char* OSCMSG_NEXT_MODULE = "/pylades/next";
+static constexpr const char* OSCMSG_SELECT_MODULE = "/pylades/select";
+static constexpr const char* OSCMSG_LIST_MODULES = "/pylades/listmodules";
+static constexpr const char* OSCMSG_RESET_PARAM = "/pylades/resetparam";
+static constexpr const char* OSCMSG_RESEND = "/pylades/resend";
+static constexpr const char* OSCMSG_APPLY_MODULE = "/pylades/apply/modulemapping";
+static constexpr const char* OSCMSG_APPLY_RACK_MAPPING = "/pylades/apply/rackmapping";
+static constexpr const char* OSCMSG_VERSION_POLL = "/pylades/version";
+static constexpr const char* OSCMSG_SYNC = "/pylades/sync";
+static constexpr const char* OSCMSG_PAGE = "/pylades/page";
+static constexpr const char* OSCMSG_PROTOCOL = "/pylades/protocol";
 
+/** Inbound OSC commands, resolved from the message address on the OSC listener thread */
+enum class OSCCOMMAND {
+	UNKNOWN = 0,
+	FADER,
+	PREV_MODULE,
+	NEXT_MODULE,
+	SELECT_MODULE,
+	LIST_MODULES,
+	RESET_PARAM,
+	RESEND,
+	APPLY_MODULE,
+	APPLY_RACK_MAPPING,
+	VERSION_POLL,
+	SYNC,
+	PAGE,
+	PROTOCOL
+};
 
+/** 32-bit FNV-1a hash of an OSC address, usable in constant expressions */
+constexpr uint32_t oscAddressHash(const char* s, uint32_t h = 2166136261u) {
+	return *s ? oscAddressHash(s + 1, (h ^ (uint32_t)(uint8_t)*s) * 16777619u) : h;
+}
+
+inline OSCCOMMAND oscCommandIf(const char* address, const char* commandAddress, OSCCOMMAND command) {
+	return std::strcmp(address, commandAddress) == 0 ? command : OSCCOMMAND::UNKNOWN;
+}
+
+/**
+ * Maps an OSC address to its OSCCOMMAND.
+ * The case labels are the hashes of the OSCMSG_* addresses, so the compiler rejects a hash collision
+ * within the table; the final strcmp rejects unknown addresses that happen to share a hash.
+ */
+inline OSCCOMMAND resolveOscCommand(const char* address) {
+	switch (oscAddressHash(address)) {
+		case oscAddressHash(OSCMSG_FADER): return oscCommandIf(address, OSCMSG_FADER, OSCCOMMAND::FADER);
+		case oscAddressHash(OSCMSG_PREV_MODULE): return oscCommandIf(address, OSCMSG_PREV_MODULE, OSCCOMMAND::PREV_MODULE);
+		case oscAddressHash(OSCMSG_NEXT_MODULE): return oscCommandIf(address, OSCMSG_NEXT_MODULE, OSCCOMMAND::NEXT_MODULE);
+		case oscAddressHash(OSCMSG_SELECT_MODULE): return oscCommandIf(address, OSCMSG_SELECT_MODULE, OSCCOMMAND::SELECT_MODULE);
+		case oscAddressHash(OSCMSG_LIST_MODULES): return oscCommandIf(address, OSCMSG_LIST_MODULES, OSCCOMMAND::LIST_MODULES);
+		case oscAddressHash(OSCMSG_RESET_PARAM): return oscCommandIf(address, OSCMSG_RESET_PARAM, OSCCOMMAND::RESET_PARAM);
+		case oscAddressHash(OSCMSG_RESEND): return oscCommandIf(address, OSCMSG_RESEND, OSCCOMMAND::RESEND);
+		case oscAddressHash(OSCMSG_APPLY_MODULE): return oscCommandIf(address, OSCMSG_APPLY_MODULE, OSCCOMMAND::APPLY_MODULE);
+		case oscAddressHash(OSCMSG_APPLY_RACK_MAPPING): return oscCommandIf(address, OSCMSG_APPLY_RACK_MAPPING, OSCCOMMAND::APPLY_RACK_MAPPING);
+		case oscAddressHash(OSCMSG_VERSION_POLL): return oscCommandIf(address, OSCMSG_VERSION_POLL, OSCCOMMAND::VERSION_POLL);
+		case oscAddressHash(OSCMSG_SYNC): return oscCommandIf(address, OSCMSG_SYNC, OSCCOMMAND::SYNC);
+		case oscAddressHash(OSCMSG_PAGE): return oscCommandIf(address, OSCMSG_PAGE, OSCCOMMAND::PAGE);
+		case oscAddressHash(OSCMSG_PROTOCOL): return oscCommandIf(address, OSCMSG_PROTOCOL, OSCCOMMAND::PROTOCOL);
+		default: return OSCCOMMAND::UNKNOWN;
+	}
+}
 
 } // namespace OrestesOne
 } // namespace Orestes
\ No newline at end of file
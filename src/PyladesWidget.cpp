@@ -120,7 +120,7 @@ struct PyladesChoice : MapModuleChoice<MAX_CHANNELS, PyladesModule> {
 				int id;
 				void onSelectKey(const event::SelectKey& e) override {
 					if (e.action == GLFW_PRESS && e.key == GLFW_KEY_ENTER) {
-						module->textLabel[id] = text;
+						module->setTextLabel(id, text);
 
 						ui::MenuOverlay* overlay = getAncestorOfType<ui::MenuOverlay>();
 						overlay->requestDelete();
@@ -137,7 +137,7 @@ struct PyladesChoice : MapModuleChoice<MAX_CHANNELS, PyladesModule> {
 				PyladesModule* module;
 				int id;
 				void onAction(const event::Action& e) override {
-					module->textLabel[id] = "";
+					module->setTextLabel(id, "");
 				}
 			};
 
@@ -272,7 +272,7 @@ struct MemDisplay : OrestesLedDisplay {
 	void step() override {
 		OrestesLedDisplay::step();
 		if (!module) return;
-		text = string::f("%i", (int)module->midiMap.size());
+		text = string::f("%i", (int)module->midiMap.get()->size());
 	}
 };
 
@@ -360,6 +360,15 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 	void step() override {
 		ThemedModuleWidget<PyladesModule>::step();
 		if (module) {
+			module->formatOSCFeedback();
+
+			// Let the adaptive scan rate know when one of our parameters is moved with the mouse
+			if (module->processAdaptive) {
+				ParamWidget* pw = dynamic_cast<ParamWidget*>(APP->event->getDraggedWidget());
+				ParamHandle* h = pw && pw->module ? APP->engine->getParamHandle(pw->module->id, pw->paramId) : NULL;
+				module->paramDragged = h && h >= &module->paramHandles[0] && h < &module->paramHandles[MAX_CHANNELS];
+			}
+
 
 			if (receiveTrigger.process(module->params[PyladesModule::PARAM_RECV].getValue() > 0.0f)) {
 				module->receiving ^= true;
@@ -398,10 +407,7 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 			if (module->midiMapLibraryFilename.empty()) {
 				// DEBUG("No known mapping library, so try and load default or factory library");
 				// Load default mapping library else load and save plugin factory library
-				bool midiMapLoaded = module->loadDefaultMappingLibraryFromPresetFolder();
-				if (!midiMapLoaded) {
-					module->createMappingLibraryFromFactory();
-				}
+				module->loadMappingLibrary();
 			}
 
 
@@ -596,7 +602,8 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 
 		// Update library filename
 		module->midiMapLibraryFilename = path;
-		module->expMemPluginDeleteAll();
+		// Start from an empty library, leaving the one of the previous file to the instances sharing it
+		module->resetMap();
 		module->expMemSaveLibrary(true);
 	}
 
@@ -621,29 +628,13 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 	void loadMidiMapLibrary_action(std::string filename) {
 		// DEBUG("Loading mapping library from file %s", filename.c_str());
 
-		FILE* file = fopen(filename.c_str(), "r");
-		if (!file) {
-			WARN("Could not load file %s", filename.c_str());
-			return;
-		}
-		DEFER({
-			fclose(file);
-		});
-
-		json_error_t error;
-		json_t* libraryJ = json_loadf(file, 0, &error);
-		if (!libraryJ) {
-			std::string message = string::f("File is not a valid JSON file. Parsing error at %s %d:%d %s", error.source, error.line, error.column, error.text);
+		json_t* currentStateJ = toJson();
+		if (!module->readMappingLibraryFile(filename)) {
+			json_decref(currentStateJ);
+			std::string message = string::f("File %s is not a valid mapping library file", filename.c_str());
 			osdialog_message(OSDIALOG_WARNING, OSDIALOG_OK, message.c_str());
 			return;
 		}
-		DEFER({
-			json_decref(libraryJ);
-		});
-
-		json_t* currentStateJ = toJson();
-		if (!module->loadMidiMapFromLibrary(libraryJ))
-			return;
 
 		// Update library filename
 		module->midiMapLibraryFilename = filename;
@@ -783,26 +774,27 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 		size_t i;
 		json_t* midiMapJJ;
 		int importedModules = 0;
-		json_array_foreach(midiMapJ, i, midiMapJJ) {
-			std::string importedPluginSlug = json_string_value(json_object_get(midiMapJJ, "ps"));
-			std::string importedModuleSlug = json_string_value(json_object_get(midiMapJJ, "ms"));
-
-			// Find this mapped module in the current Pylades module midiMap
-			auto p = std::pair<std::string, std::string>(importedPluginSlug, importedModuleSlug);
-			auto it = module->midiMap.find(p);
-			if (it != module->midiMap.end()) {
-				if (skipPremappedModules) {
-					continue;
+		module->waitForMappingLibrary();
+		module->midiMap.update([&](MappingLibrary& lib) {
+			json_array_foreach(midiMapJ, i, midiMapJJ) {
+				std::string importedPluginSlug = json_string_value(json_object_get(midiMapJJ, "ps"));
+				std::string importedModuleSlug = json_string_value(json_object_get(midiMapJJ, "ms"));
+
+				// Find this mapped module in the current Pylades module midiMap
+				if (lib.find(importedPluginSlug, importedModuleSlug)) {
+					if (skipPremappedModules) {
+						continue;
+					}
+					lib.erase(importedPluginSlug, importedModuleSlug);
 				}
-				delete it->second;
-				module->midiMap.erase(p);
-			}
-			
-			// Add new entry to midiMap
-			module->midiMapJSONToMidiMap(midiMapJJ);
-			importedModules++;
-			
-		};
+
+				// Add new entry to midiMap
+				std::string pluginSlug, moduleSlug;
+				if (!MappingLibrary::fromJson(midiMapJJ, pluginSlug, moduleSlug, module->loadedMapping)) continue;
+				lib.set(pluginSlug, moduleSlug, module->loadedMapping);
+				importedModules++;
+			};
+		});
 
 		// currentStateJ* now has the updated merged midimap
 		// DEBUG("Imported mappings for %d modules", importedModules);
@@ -1043,7 +1035,6 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 
 	void appendContextMenu(Menu* menu) override {
 		ThemedModuleWidget<PyladesModule>::appendContextMenu(menu);
-		int sampleRate = int(APP->engine->getSampleRate());
 
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createSubmenuItem("Preset load", "",
@@ -1053,15 +1044,48 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 			}
 		));
 		menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Precision", {
-				{ 2048, string::f("High (%i Hz)", sampleRate / 2048) },
-				{ 4098, string::f("Medium (%i Hz)", sampleRate / 4098) },
-				{ 8192, string::f("Low (%i Hz)", sampleRate / 8192) }
+				{ 46, string::f("High (%i Hz)", CONTROL_RATE / 46) },
+				{ 93, string::f("Medium (%i Hz)", CONTROL_RATE / 93) },
+				{ 186, string::f("Low (%i Hz)", CONTROL_RATE / 186) }
 			},
 			[=]() {
-				return module->processDivision;
+				return module->processInterval;
 			},
-			[=](int division) {
-				module->setProcessDivision(division);
+			[=](int interval) {
+				module->setProcessInterval(interval);
+			}
+		));
+		menu->addChild(createSubmenuItem("Adaptive precision", module->processAdaptive ? "On" : "",
+			[=](Menu* menu) {
+				menu->addChild(createBoolMenuItem("Enabled", "",
+					[=]() { return module->processAdaptive; },
+					[=](bool adaptive) { module->setProcessAdaptive(adaptive); }
+				));
+				menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Ceiling", {
+						{ 10, string::f("%i Hz", CONTROL_RATE / 10) },
+						{ 23, string::f("%i Hz", CONTROL_RATE / 23) },
+						{ 46, string::f("%i Hz", CONTROL_RATE / 46) }
+					},
+					[=]() {
+						return module->processIntervalMin;
+					},
+					[=](int ms) {
+						module->setProcessIntervalLimits(ms, module->processIntervalMax);
+					}
+				));
+				menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("Floor", {
+						{ 186, string::f("%i Hz", CONTROL_RATE / 186) },
+						{ 372, string::f("%i Hz", CONTROL_RATE / 372) },
+						{ 1000, string::f("%i Hz", CONTROL_RATE / 1000) }
+					},
+					[=]() {
+						return module->processIntervalMax;
+					},
+					[=](int ms) {
+						module->setProcessIntervalLimits(module->processIntervalMin, ms);
+					}
+				));
+				menu->addChild(createMenuLabel(string::f("Current rate: %.1f Hz", float(CONTROL_RATE) / module->processIntervalCurrent)));
 			}
 		));
 		menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<MIDIMODE>("Mode", {
@@ -1075,12 +1099,33 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 				module->setMode(midiMode);
 			}
 		));
+		if (module->lastSwitchUs >= 0) {
+			menu->addChild(createMenuLabel(string::f("Last module switch: %lld µs, %i param handle updates",
+				(long long)module->lastSwitchUs, module->lastSwitchHandleUpdates)));
+		}
 		menu->addChild(createSubmenuItem("Re-send OSC feedback", "",
 			[=](Menu* menu) {
 				menu->addChild(createMenuItem("Now", "", [=]() { module->oscResendFeedback(); }));
 				menu->addChild(createBoolPtrMenuItem("Periodically", "", &module->oscResendPeriodically));
 			}
 		));
+		menu->addChild(RSBATechModules::Rack::createMapSubmenuItem<int>("OSC feedback datagram size", {
+				{ 512, "512 bytes" },
+				{ (int)TheModularMind::OscSender::MTU_DATAGRAM_SIZE, string::f("%i bytes (Ethernet MTU)", TheModularMind::OscSender::MTU_DATAGRAM_SIZE) },
+				{ (int)TheModularMind::OscSender::ENCODE_BUFFER_SIZE, string::f("%i bytes (localhost)", TheModularMind::OscSender::ENCODE_BUFFER_SIZE) }
+			},
+			[=]() {
+				return module->oscMaxDatagramSize;
+			},
+			[=](int size) {
+				module->setOscMaxDatagramSize(size);
+			}
+		));
+		if (module->sending) {
+			TheModularMind::OscSender& sender = module->oscSender;
+			menu->addChild(createMenuLabel(string::f("OSC transmit: %i queued, %i dropped, %i µs latency (max %i µs)",
+				sender.getQueueDepth(), sender.getDropCount(), sender.getSendLatencyUs(), sender.getMaxSendLatencyUs())));
+		}
 	
 		menu->addChild(new MenuSeparator());
 		menu->addChild(createSubmenuItem("User interface", "",
@@ -1126,7 +1171,6 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 					PyladesModule* module;
 					std::string pluginSlug;
 					std::string moduleSlug;
-					MemModule* midimapModule;
 					MidimapModuleItem() {
 						rightText = RIGHT_ARROW;
 					}
@@ -1174,20 +1218,19 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 
 
 						std::list<std::pair<std::string, MidimapModuleItem*>> l; 
-						for (auto it : module->midiMap) {
-							if (it.first.first == pluginSlug) {
-								MemModule* a = it.second;
+						MappingLibraryCache::Snapshot lib = module->midiMap.get();
+						for (const MappingLibrary::Entry* a : lib->sorted()) {
+							if (lib->str(a->pluginSlug) == pluginSlug) {
 								MidimapModuleItem* midimapModuleItem = new MidimapModuleItem;
 								if (a->autoMapped) {
-									midimapModuleItem->text = string::f("%s (A)", a->moduleName.c_str());
+									midimapModuleItem->text = string::f("%s (A)", lib->str(a->moduleName).c_str());
 								} else {
-									midimapModuleItem->text = string::f("%s", a->moduleName.c_str());
+									midimapModuleItem->text = string::f("%s", lib->str(a->moduleName).c_str());
 								}
 								
 								midimapModuleItem->module = module;
-								midimapModuleItem->midimapModule = a;
-								midimapModuleItem->pluginSlug = it.first.first;
-								midimapModuleItem->moduleSlug = it.first.second;
+								midimapModuleItem->pluginSlug = lib->str(a->pluginSlug);
+								midimapModuleItem->moduleSlug = lib->str(a->moduleSlug);
 								l.push_back(std::pair<std::string, MidimapModuleItem*>(midimapModuleItem->text, midimapModuleItem));
 							}
 						}
@@ -1208,14 +1251,14 @@ struct PyladesWidget : ThemedModuleWidget<PyladesModule>, ParamWidgetContextExte
 				std::map<std::string, MidimapPluginItem*> l;
 				l.clear();
 
-				for (auto it : module->midiMap) {
-					MemModule* a = it.second;
-					if (l.find(it.first.first) == l.end()) {
+				MappingLibraryCache::Snapshot lib = module->midiMap.get();
+				for (const MappingLibrary::Entry* a : lib->sorted()) {
+					if (l.find(lib->str(a->pluginName)) == l.end()) {
 						// Map does not already have an entry for this plugin, so add one now
 						MidimapPluginItem* midimapPluginItem = new MidimapPluginItem;
-						midimapPluginItem->text = string::f("%s", a->pluginName.c_str());
+						midimapPluginItem->text = string::f("%s", lib->str(a->pluginName).c_str());
 						midimapPluginItem->module = module;
-						midimapPluginItem->pluginSlug = it.first.first;
+						midimapPluginItem->pluginSlug = lib->str(a->pluginSlug);
 						l[midimapPluginItem->text] = midimapPluginItem;	
 					}
 				}
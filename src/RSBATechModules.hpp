@@ -1,6 +1,7 @@
 #pragma once
 #include "plugin.hpp"
 #include "digital/ScaledMapParam.hpp"
+#include "digital/FeedbackTexts.hpp"
 #include <array>
 
 namespace RSBATechModules {
@@ -8,6 +9,18 @@ namespace RSBATechModules {
 static const int MAX_CHANNELS = 300;
 static const int MAX_NPRN_ID = 299; // 0 to MAX_NPRN_ID
 static const int MAX_PAGES = 6;
+/** Controls on each controller page, NPRN n is shown on page n / NPRNS_PER_PAGE */
+static const int NPRNS_PER_PAGE = 36;
+/** Feedback messages sent per scan for the channels on pages the controller doesn't show */
+static const int HIDDEN_FEEDBACK_PER_SCAN = 4;
+/** Rate in Hz at which the modules do their work, so one control tick is one millisecond */
+static const int CONTROL_RATE = 1000;
+/**
+ * Latest revision of the controller feedback protocol. Revision 1 sends the parameter name with every value,
+ * revision 2 sends names and units once per module switch in a metadata block, see sendMetadata(), and
+ * revision 3 also sends the values of a module switch together in a snapshot, see sendSnapshot().
+ */
+static const int PROTOCOL_VERSION = 3;
 
 static const char LOAD_MIDIMAP_FILTERS[] = "VCV Rack module preset (.vcvm):vcvm, JSON (.json):json";
 static const char SAVE_JSON_FILTERS[] = "JSON (.json):json";
@@ -22,6 +35,34 @@ enum class NPRNMODE {
 	TOGGLE_VALUE = 4
 };
 
+/**
+ * Checksum of the NPRN values in firstNprn .. lastNprn known to a controller, for the sync command of
+ * Pylades and OrestesOne. Values of -1 (never exchanged with the controller) are skipped, the others are
+ * folded in ascending NPRN order as h = (h * 31 + nprn) mod 2^24, h = (h * 31 + value) mod 2^24.
+ * Kept below 2^24 so a controller script can compute it with double-precision Lua numbers.
+ */
+inline int nprnSyncChecksum(const int* values, int firstNprn, int lastNprn) {
+	int h = 0;
+	for (int nprn = firstNprn; nprn <= lastNprn; nprn++) {
+		if (values[nprn] < 0) continue;
+		h = (h * 31 + nprn) & 0xFFFFFF;
+		h = (h * 31 + values[nprn]) & 0xFFFFFF;
+	}
+	return h;
+}
+
+/**
+ * 32-bit FNV-1a hash of size bytes, continued from h. Used as the key of the feedback metadata blocks of
+ * Pylades and OrestesOne, so a controller can cache a layout it has seen before.
+ */
+inline uint32_t fnv1aHash(const void* data, std::size_t size, uint32_t h = 2166136261u) {
+	const uint8_t* p = (const uint8_t*)data;
+	for (std::size_t i = 0; i < size; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+	return h;
+}
+
 static const std::set<std::pair<std::string, std::string>> AUTOMAP_EXCLUDED_MODULES {
 	std::pair<std::string, std::string>("RSBATechModules", "OrestesOne"),
 	std::pair<std::string, std::string>("MindMeldModular", "PatchMaster")
@@ -29,6 +70,8 @@ static const std::set<std::pair<std::string, std::string>> AUTOMAP_EXCLUDED_MODU
 
 static const std::string DEFAULT_LIBRARY_FILENAME = "midimap-library.json";
 static const std::string FACTORY_LIBRARY_FILENAME = "factory-midimap-library.json";
+/** Appended to a mapping library filename for its binary image, see MappingLibrary::saveImage() */
+static const std::string LIBRARY_IMAGE_EXTENSION = ".bin";
 
 struct MemParam {
 	int paramId = -1;
@@ -0,0 +1,59 @@
+#pragma once
+#include "plugin.hpp"
+
+namespace RSBATechModules {
+
+/*
+Slew state of all mapping channels of a module, stored as struct-of-arrays.
+
+Each ScaledMapParam bound to a channel keeps its slew target, filter output and rate here instead of in its
+own ExponentialSlewLimiter, so process() steps the filters of every channel in one pass of simd::float_4
+arithmetic, four channels at a time.
+*/
+
+struct ChannelBank {
+	/** Slew target of each channel, 0 .. 1 */
+	std::vector<float> in;
+	/** Filter output of each channel, 0 .. 1 */
+	std::vector<float> out;
+	/** Rate of each channel, 0 if the channel has no slew */
+	std::vector<float> lambda;
+
+	void setChannels(int channels) {
+		// Padded to whole float_4 groups, the padding channels stay at 0
+		int size = (channels + 3) & ~3;
+		in.assign(size, 0.f);
+		out.assign(size, 0.f);
+		lambda.assign(size, 0.f);
+	}
+
+	int getChannels() {
+		return int(in.size());
+	}
+
+	void reset(int channel, float value) {
+		in[channel] = value;
+		out[channel] = value;
+	}
+
+	/**
+	 * Advances the filters of the first `channels` channels by `deltaTime` seconds, with the same response as
+	 * dsp::ExponentialSlewLimiter. Channels without slew are set to their target.
+	 */
+	void process(float deltaTime, int channels) {
+		int size = std::min((channels + 3) & ~3, getChannels());
+		simd::float_4 dt = deltaTime;
+		for (int i = 0; i < size; i += 4) {
+			simd::float_4 x = simd::float_4::load(&in[i]);
+			simd::float_4 y = simd::float_4::load(&out[i]);
+			// Limited to one full step, so long gaps between calls can't overshoot the target
+			simd::float_4 k = simd::fmin(simd::float_4::load(&lambda[i]) * dt, 1.f);
+			simd::float_4 z = y + (x - y) * k;
+			// If the change is too small for floats (or there is no slew) jump to the target
+			z = simd::ifelse(z == y, x, z);
+			z.store(&out[i]);
+		}
+	}
+};
+
+} // namespace RSBATechModules
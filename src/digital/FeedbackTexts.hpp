@@ -0,0 +1,177 @@
+#pragma once
+#include "plugin.hpp"
+#include <atomic>
+#include <cstring>
+
+namespace RSBATechModules {
+
+/*
+Display texts (parameter name, value and unit) of mapped parameters, formatted outside the engine thread.
+
+The engine thread only requests the text of a channel. The module widget's step() formats the requested
+channels on the UI thread, where ParamQuantity's display strings and the widget tree are safe to use, and
+hands the texts back through a ring buffer. The engine then sends each text only if it differs from the
+last one it sent for the channel, and is told whether the name and unit or only the value changed.
+
+Requests for the same channel coalesce until the next step(), and the text is formatted from the
+parameter's value at that time.
+*/
+
+template <int CHANNELS>
+struct FeedbackTexts {
+	static const int WORDS = (CHANNELS + 63) / 64;
+	static const int TEXT_LENGTH = 64;
+	static const int UNIT_LENGTH = 16;
+
+	struct Text {
+		/** Channel, or -1 for the marker queued by requestMarker() */
+		int id;
+		char name[TEXT_LENGTH];
+		char value[TEXT_LENGTH];
+		char unit[UNIT_LENGTH];
+
+		void set(const char* name, const char* value, const char* unit) {
+			copy(this->name, name);
+			copy(this->value, value);
+			copy(this->unit, unit);
+		}
+
+		/** Truncates long texts at a UTF-8 character boundary */
+		template <std::size_t N>
+		static void copy(char (&dst)[N], const char* src) {
+			std::size_t len = std::strlen(src);
+			if (len >= N) {
+				len = N - 1;
+				while (len > 0 && (src[len] & 0xC0) == 0x80) len--;
+			}
+			std::memcpy(dst, src, len);
+			dst[len] = '\0';
+		}
+	};
+
+	FeedbackTexts() {
+		for (int i = 0; i < WORDS; i++) {
+			requested[i].store(0);
+		}
+		for (int i = 0; i < CHANNELS; i++) {
+			sentValid[i] = false;
+		}
+	}
+
+	/** Engine thread */
+	void request(int id) {
+		if (id < 0 || id >= CHANNELS) return;
+		requested[id >> 6].fetch_or((uint64_t)1 << (id & 63), std::memory_order_release);
+	}
+
+	/** Engine thread. receive() returns a marker once all texts requested before this call have been received. */
+	void requestMarker() {
+		marker.store(true, std::memory_order_release);
+	}
+
+	/** Any thread. The next receive() sends every text again, e.g. after the controller switched modules. */
+	void clearSent() {
+		clearRequested.store(true, std::memory_order_release);
+	}
+
+	/** Engine thread. The next text received for the channel is sent even if unchanged. */
+	void clearSent(int id) {
+		if (id < 0 || id >= CHANNELS) return;
+		sentValid[id] = false;
+	}
+
+	/**
+	 * UI thread. Calls f(Text&) with the id set for every requested channel. f fills in the text, or returns false
+	 * if the channel has no text.
+	 */
+	template <typename F>
+	void format(F f) {
+		// Read before the requests, so the marker follows every text requested before it
+		bool m = marker.exchange(false, std::memory_order_acquire);
+		bool deferred = false;
+		for (int w = 0; w < WORDS; w++) {
+			if (requested[w].load(std::memory_order_relaxed) == 0) continue;
+			uint64_t bits = requested[w].exchange(0, std::memory_order_acquire);
+			while (bits) {
+				int id = (w << 6) + __builtin_ctzll(bits);
+				bits &= bits - 1;
+				if (texts.full()) {
+					// Engine has not caught up, try again on the next step
+					request(id);
+					deferred = true;
+					continue;
+				}
+				Text t;
+				t.id = id;
+				if (f(t)) texts.push(t);
+			}
+		}
+		if (m) {
+			if (texts.full() || deferred) {
+				marker.store(true, std::memory_order_release);
+			}
+			else {
+				Text t;
+				t.id = -1;
+				t.name[0] = t.value[0] = t.unit[0] = '\0';
+				texts.push(t);
+			}
+		}
+	}
+
+	/**
+	 * Engine thread. Calls send(const Text&, bool metaChanged, bool valueChanged) for each formatted text that differs
+	 * from the one sent before, where metaChanged tells if the name or unit differ and valueChanged if the value does.
+	 * Markers are passed with both flags false. send returns false if the text could not be sent, then it is not
+	 * recorded as sent and the channel is requested again.
+	 */
+	template <typename F>
+	void receive(F send) {
+		if (clearRequested.exchange(false, std::memory_order_acquire)) {
+			for (int i = 0; i < CHANNELS; i++) {
+				sentValid[i] = false;
+			}
+		}
+		while (!texts.empty()) {
+			Text t = texts.shift();
+			if (t.id < 0) {
+				send(t, false, false);
+				continue;
+			}
+			const Text& s = sent[t.id];
+			bool metaChanged = !sentValid[t.id] || std::strcmp(s.name, t.name) != 0 || std::strcmp(s.unit, t.unit) != 0;
+			bool valueChanged = !sentValid[t.id] || std::strcmp(s.value, t.value) != 0;
+			if (!metaChanged && !valueChanged) continue;
+			if (!send(t, metaChanged, valueChanged)) {
+				request(t.id);
+				continue;
+			}
+			sent[t.id] = t;
+			sentValid[t.id] = true;
+		}
+	}
+
+	/** Engine thread. The text last sent for a channel, or NULL if none was sent since clearSent(). */
+	const Text* getSent(int id) {
+		if (id < 0 || id >= CHANNELS || !sentValid[id]) return NULL;
+		return &sent[id];
+	}
+
+	/** Engine thread */
+	bool empty() {
+		return texts.empty() && !clearRequested.load(std::memory_order_relaxed);
+	}
+
+   private:
+	/** One bit per channel requested but not yet formatted */
+	std::atomic<uint64_t> requested[WORDS];
+	std::atomic<bool> marker{false};
+	std::atomic<bool> clearRequested{false};
+	/** Formatted texts, UI thread to engine thread */
+	dsp::RingBuffer<Text, 512> texts;
+	/** Engine thread only */
+	Text sent[CHANNELS];
+	bool sentValid[CHANNELS];
+};
+
+} // namespace RSBATechModules
@@ -1,5 +1,6 @@
 #pragma once
 #include "plugin.hpp"
+#include "ChannelBank.hpp"
 
 namespace RSBATechModules {
     
@@ -13,8 +14,23 @@ struct ScaledMapParam {
 	T uninit;
 	float min = 0.f;
 	float max = 1.f;
-
-	dsp::ExponentialSlewLimiter filter;
+	/** rescale() factors from limitMin .. limitMax to min .. max and back, kept in step by updateScale() */
+	float scaleIn = 1.f;
+	float scaleOut = 1.f;
+
+	/** Target resolved by setTarget() and kept until reset(), so processing passes skip the ParamQuantity lookup */
+	Module* targetModule = NULL;
+	int targetParamId = -1;
+	/** NULL for "fake" ParamQuantities of CV ports, which are only accessed through paramQuantity */
+	Param* param = NULL;
+	float paramMin = 0.f;
+	float paramRange = 1.f;
+	float paramRangeInv = 1.f;
+	bool paramSnap = false;
+
+	/** Holds the slew filter of this parameter, without a bank the parameter has no slew */
+	ChannelBank* bank = NULL;
+	int channel = 0;
 	bool filterInitialized;
 	float filterSlew;
 	T valueIn;
@@ -31,6 +47,12 @@ struct ScaledMapParam {
 		limitMax = float(max);
 		limitMaxT = max;
 		this->uninit = uninit;
+		updateScale();
+	}
+
+	void updateScale() {
+		scaleIn = (max - min) / (limitMax - limitMin);
+		scaleOut = (limitMax - limitMin) / (max - min);
 	}
 	T getLimitMin() {
 		return limitMinT;
@@ -41,7 +63,9 @@ struct ScaledMapParam {
 
 	virtual void reset(bool resetSettings = true) {
 		paramQuantity = NULL;
-		filter.reset();
+		targetModule = NULL;
+		targetParamId = -1;
+		param = NULL;
 		filterInitialized = false;
 		valueIn = uninit;
 		value = -1.f;
@@ -51,11 +75,43 @@ struct ScaledMapParam {
 			filterSlew = 0.f;
 			min = 0.f;
 			max = 1.f;
+			updateScale();
+			if (bank) bank->lambda[channel] = 0.f;
 		}
 	}
 
+	void setBank(ChannelBank* bank, int channel) {
+		this->bank = bank;
+		this->channel = channel;
+		setSlew(filterSlew);
+	}
+
+	/** True if setTarget() was last called for this module and parameter. Comparing the ParamQuantity as well
+	 *  catches a module that was replaced by a new one at the same address. */
+	bool hasTarget(Module* module, int paramId) {
+		return module && module == targetModule && paramId == targetParamId
+			&& (Quantity*)module->paramQuantities[paramId] == (Quantity*)paramQuantity;
+	}
+
+	/** Resolves and caches the mapped parameter. Call again after the ParamHandle was updated. */
+	void setTarget(Module* module, int paramId, PQ* pq) {
+		targetModule = module;
+		targetParamId = paramId;
+		paramQuantity = pq;
+		param = pq->getParam();
+		paramMin = pq->getMinValue();
+		paramRange = pq->getMaxValue() - paramMin;
+		paramRangeInv = paramRange != 0.f ? 1.f / paramRange : 0.f;
+		paramSnap = pq->snapEnabled;
+	}
+
+	/** Current value of the target, normalized to 0 .. 1 */
+	float getTargetValue() {
+		if (param) return (param->getValue() - paramMin) * paramRangeInv;
+		return paramQuantity->getScaledValue();
+	}
+
 	void resetFilter() {
-		filter.reset();
 		filterInitialized = false;
 	}
 
@@ -68,8 +124,7 @@ struct ScaledMapParam {
 
 	void setSlew(float slew) {
 		filterSlew = slew;
-		float s = (1.f / slew) * 10.f;
-		filter.setRiseFall(s, s);
+		if (bank) bank->lambda[channel] = slew > 0.f ? (1.f / slew) * 10.f : 0.f;
 		if (filterSlew == 0.f) filterInitialized = false;
 	}
 	float getSlew() {
@@ -78,6 +133,7 @@ struct ScaledMapParam {
 
 	void setMin(float v) {
 		min = v;
+		updateScale();
 		if (paramQuantity && valueIn != -1) setValue(valueIn);
 	}
 	float getMin() {
@@ -86,6 +142,7 @@ struct ScaledMapParam {
 
 	void setMax(float v) {
 		max = v;
+		updateScale();
 		if (paramQuantity && valueIn != -1) setValue(valueIn);
 	}
 	float getMax() {
@@ -93,7 +150,7 @@ struct ScaledMapParam {
 	}
 
 	virtual void setValue(T i) {
-		float f = rescale(float(i), limitMin, limitMax, min, max);
+		float f = min + (float(i) - limitMin) * scaleIn;
 		f = clamp(f, 0.f, 1.f);
 		valueIn = i;
 		value = f;
@@ -103,42 +160,55 @@ struct ScaledMapParam {
 		if (valueOut == std::numeric_limits<float>::infinity()) return;
 		// Set filter from param value if filter is uninitialized
 		if (!filterInitialized) {
-			filter.out = paramQuantity->getScaledValue();
+			float v = getTargetValue();
 			// If setValue has not been called yet use the parameter's current value
-			if (value == -1.f) value = filter.out;
+			if (value == -1.f) value = v;
+			if (bank) bank->reset(channel, v);
 			filterInitialized = true;
 		}
-		float f = filterSlew > 0.f && sampleTime > 0.f ? filter.process(sampleTime, value) : value;
-		if (valueOut != f || force) {
-			Param* param = paramQuantity->getParam();
-			if (param) {
-				float vScaled = math::rescale(f, 0.f, 1.f, paramQuantity->getMinValue(), paramQuantity->getMaxValue());
-				if (paramQuantity->snapEnabled) vScaled = std::round(vScaled);
-				paramQuantity->getParam()->setValue(vScaled);
-			}
-			else {
-				// Only used by "fake" paramQuantaties for CV-ports
-				paramQuantity->setScaledValue(f);
+		float f = value;
+		if (bank) {
+			bank->in[channel] = value;
+			if (filterSlew > 0.f && sampleTime > 0.f) {
+				// The filter is stepped towards the new target after this pass, see processSlew()
+				if (force) setTargetValue(bank->out[channel]);
+				return;
 			}
-			valueOut = f;
 		}
+		if (valueOut != f || force) setTargetValue(f);
+	}
+
+	/** Writes the slew filter output to the parameter, once ChannelBank::process() has stepped it for this pass */
+	void processSlew() {
+		if (!bank || filterSlew <= 0.f || !filterInitialized || valueOut == std::numeric_limits<float>::infinity()) return;
+		float f = bank->out[channel];
+		if (valueOut != f) setTargetValue(f);
+	}
+
+	/** Sets the target to f, normalized to 0 .. 1 */
+	void setTargetValue(float f) {
+		if (param) {
+			float vScaled = paramMin + f * paramRange;
+			if (paramSnap) vScaled = std::round(vScaled);
+			param->setValue(vScaled);
+		}
+		else {
+			// Only used by "fake" paramQuantaties for CV-ports
+			paramQuantity->setScaledValue(f);
+		}
+		valueOut = f;
 	}
 
 	virtual T getValue() {
-		float f = paramQuantity->getScaledValue();
+		// Reads the Param directly, which also bypasses ParamQuantity for snapped parameters whose
+		// scaled value can't be trusted
+		float f = getTargetValue();
 		if (isNear(valueOut, f)) return valueIn;
 		// Reset the internal values to the actual parameter's value in case 
 		// getValue() is called before setValue() - for proper MIDI feedback
 		if (valueOut == std::numeric_limits<float>::infinity()) value = valueOut = f;
 		
-		// If a parameter is snapped then the returned value of ParamQuantity can't be trusted
-		// -> Use the parameter's actual value bypassing ParamQuantity
-		if (paramQuantity->snapEnabled) {
-			f = paramQuantity->getParam()->getValue();
-			f = math::rescale(f, paramQuantity->getMinValue(), paramQuantity->getMaxValue(), 0.f, 1.f);
-		}
-		
-		f = rescale(f, min, max, limitMin, limitMax);
+		f = limitMin + (f - min) * scaleOut;
 		f = clamp(f, limitMin, limitMax);
 
 		T i = T(f);
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "oscpack/osc/OscTypes.h"
+
+/*
+Fixed-size OSC message used on the receive path.
+
+Unlike OscMessage, it owns no heap memory: the address, up to MAX_ARGS int/float/string arguments and
+the string argument characters are all stored inline. It can be pushed through a dsp::RingBuffer by plain
+copy, so neither the listener thread nor the engine thread touch the allocator for incoming messages.
+*/
+
+namespace TheModularMind {
+
+struct OscInboundMessage {
+	static const std::size_t MAX_ADDRESS_LENGTH = 64;
+	static const std::size_t MAX_ARGS = 8;
+	static const std::size_t MAX_STRING_STORAGE = 128;
+
+	/** Null-terminated OSC address pattern */
+	char address[MAX_ADDRESS_LENGTH];
+	/** Application-defined id of the address, see OscReceiver::setAddressResolver() */
+	int addressId;
+	/** One osc::TypeTagValues per argument */
+	char argTypes[MAX_ARGS];
+	union Arg {
+		std::int32_t i;
+		float f;
+		/** Offset of a null-terminated string in stringStorage */
+		std::uint16_t stringOffset;
+	} args[MAX_ARGS];
+	std::uint8_t numArgs;
+	std::uint16_t stringStorageLength;
+	char stringStorage[MAX_STRING_STORAGE];
+
+	/** IPv4 address of the sender in host byte order, as in IpEndpointName */
+	std::uint32_t remoteAddress;
+	int remotePort;
+
+	void clear() {
+		address[0] = '\0';
+		addressId = 0;
+		numArgs = 0;
+		stringStorageLength = 0;
+		remoteAddress = 0;
+		remotePort = 0;
+	}
+
+	/** Returns false if the address does not fit, leaving the message with an empty address */
+	bool setAddress(const char* addressPattern) {
+		std::size_t len = std::strlen(addressPattern);
+		if (len >= MAX_ADDRESS_LENGTH) {
+			address[0] = '\0';
+			return false;
+		}
+		std::memcpy(address, addressPattern, len + 1);
+		return true;
+	}
+
+	void setRemoteEndpoint(std::uint32_t address, int port) {
+		remoteAddress = address;
+		remotePort = port;
+	}
+
+	bool addIntArg(std::int32_t argument) {
+		if (numArgs >= MAX_ARGS) return false;
+		argTypes[numArgs] = osc::INT32_TYPE_TAG;
+		args[numArgs++].i = argument;
+		return true;
+	}
+
+	bool addFloatArg(float argument) {
+		if (numArgs >= MAX_ARGS) return false;
+		argTypes[numArgs] = osc::FLOAT_TYPE_TAG;
+		args[numArgs++].f = argument;
+		return true;
+	}
+
+	/** Returns false if the argument table or the string storage is full */
+	bool addStringArg(const char* argument) {
+		if (numArgs >= MAX_ARGS) return false;
+		std::size_t len = std::strlen(argument);
+		if (stringStorageLength + len + 1 > MAX_STRING_STORAGE) return false;
+		std::memcpy(stringStorage + stringStorageLength, argument, len + 1);
+		argTypes[numArgs] = osc::STRING_TYPE_TAG;
+		args[numArgs++].stringOffset = stringStorageLength;
+		stringStorageLength += len + 1;
+		return true;
+	}
+
+	const char* getAddress() const { return address; }
+	int getAddressId() const { return addressId; }
+	std::size_t getNumArgs() const { return numArgs; }
+
+	osc::TypeTagValues getArgType(std::size_t index) const {
+		if (index >= numArgs) return osc::NIL_TYPE_TAG;
+		return (osc::TypeTagValues)argTypes[index];
+	}
+
+	/** Numeric arguments are converted, anything else reads as 0 */
+	std::int32_t getArgAsInt(std::size_t index) const {
+		switch (getArgType(index)) {
+			case osc::INT32_TYPE_TAG: return args[index].i;
+			case osc::FLOAT_TYPE_TAG: return (std::int32_t)args[index].f;
+			default: return 0;
+		}
+	}
+
+	float getArgAsFloat(std::size_t index) const {
+		switch (getArgType(index)) {
+			case osc::FLOAT_TYPE_TAG: return args[index].f;
+			case osc::INT32_TYPE_TAG: return (float)args[index].i;
+			default: return 0.f;
+		}
+	}
+
+	/** Returns an empty string for non-string arguments. The pointer is valid as long as this message is. */
+	const char* getArgAsString(std::size_t index) const {
+		if (getArgType(index) != osc::STRING_TYPE_TAG) return "";
+		return stringStorage + args[index].stringOffset;
+	}
+};
+
+static_assert(std::is_trivially_copyable<OscInboundMessage>::value, "OscInboundMessage must be trivially copyable");
+
+}  // namespace TheModularMind
@@ -0,0 +1,90 @@
+#pragma once
+#include "plugin.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "oscpack/ip/UdpSocket.h"
+
+/*
+Process-wide OSC listening thread.
+
+All OscReceiver instances attach their sockets to one SocketReceiveMultiplexer, served by a single thread
+that exists only while at least one socket is attached. The multiplexer can only be reconfigured while it is
+not running, so attach() and detach() break its Run() loop, join the thread, change the socket set and start
+the thread again. After detach() returns the listener of the detached socket is never called again.
+*/
+
+namespace TheModularMind {
+
+struct OscListenerThread {
+	static OscListenerThread& instance() {
+		static OscListenerThread listenerThread;
+		return listenerThread;
+	}
+
+	~OscListenerThread() {
+		std::lock_guard<std::mutex> lock(mutex);
+		pause();
+	}
+
+	void attach(UdpSocket* socket, PacketListener* listener) {
+		std::lock_guard<std::mutex> lock(mutex);
+		pause();
+		mux.AttachSocketListener(socket, listener);
+		sockets++;
+		resume();
+	}
+
+	void detach(UdpSocket* socket, PacketListener* listener) {
+		std::lock_guard<std::mutex> lock(mutex);
+		pause();
+		mux.DetachSocketListener(socket, listener);
+		sockets--;
+		if (sockets > 0) resume();
+	}
+
+	/** Maximum number of datagrams read from each socket per wake-up */
+	void setReceiveBatchSize(int maxDatagrams) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (maxDatagrams == receiveBatchSize) return;
+		pause();
+		receiveBatchSize = maxDatagrams;
+		mux.SetReceiveBatchSize(maxDatagrams);
+		if (sockets > 0) resume();
+	}
+
+   private:
+	OscListenerThread() {}
+
+	SocketReceiveMultiplexer mux;
+	std::thread thread;
+	std::mutex mutex;
+	int sockets = 0;
+	int receiveBatchSize = 1;
+	/** Written under mutex, read by the listener thread */
+	std::atomic<bool> pausing{false};
+
+	void pause() {
+		if (!thread.joinable()) return;
+		pausing = true;
+		mux.AsynchronousBreak();
+		thread.join();
+		pausing = false;
+	}
+
+	void resume() {
+		thread = std::thread([this] { this->listenerProcess(); });
+	}
+
+	void listenerProcess() {
+		while (!pausing) {
+			try {
+				mux.Run();
+			} catch (std::exception& e) {
+				WARN("OscListenerThread error: %s", e.what());
+			}
+		}
+	}
+};
+
+}  // namespace TheModularMind
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/*
+Bounded queue of encoded OSC packets, handed from the engine thread to the OSC transmit thread.
+
+Packets are stored back to back in one preallocated byte ring, each behind a small header with its size and
+enqueue time, so a push copies only the bytes of the packet and never allocates. A packet that does not fit
+the space left before the end of the ring is written at its start, behind a wrap marker.
+
+Single producer, single consumer: push() never waits, so producers on several threads must take turns
+outside the queue, as OscSender does with its encode buffer.
+*/
+
+namespace TheModularMind {
+
+struct OscPacketQueue {
+	static const std::size_t CAPACITY = 65536;
+
+	struct Header {
+		std::uint32_t size;
+		std::uint32_t reserved;
+		/** Caller-defined timestamp, e.g. steady clock nanoseconds */
+		std::int64_t enqueueTime;
+	};
+
+	/** Largest packet push() accepts */
+	static const std::size_t MAX_PACKET_SIZE = CAPACITY / 2 - sizeof(Header);
+
+	/** Producer. Returns false if the queue is full or the packet is larger than MAX_PACKET_SIZE. */
+	bool push(const char* data, std::size_t size, std::int64_t enqueueTime) {
+		if (size > MAX_PACKET_SIZE) return false;
+		std::size_t recordSize = recordSizeOf(size);
+		std::size_t h = head.load(std::memory_order_relaxed);
+		std::size_t t = tail.load(std::memory_order_acquire);
+		std::size_t offset = h & (CAPACITY - 1);
+		std::size_t contiguous = CAPACITY - offset;
+		std::size_t needed = contiguous < recordSize ? contiguous + recordSize : recordSize;
+		if (CAPACITY - (h - t) < needed) return false;
+
+		if (contiguous < recordSize) {
+			// Records are multiples of sizeof(Header), so there is always room for the marker
+			header(offset)->size = WRAP_MARKER;
+			h += contiguous;
+			offset = 0;
+		}
+		Header* hd = header(offset);
+		hd->size = (std::uint32_t)size;
+		hd->enqueueTime = enqueueTime;
+		std::memcpy(buffer + offset + sizeof(Header), data, size);
+		head.store(h + recordSize, std::memory_order_release);
+		depth.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/** Consumer. Calls f(data, size, enqueueTime) for the oldest packet and removes it. Returns false if empty. */
+	template <typename F>
+	bool pop(F f) {
+		std::size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		std::size_t offset = t & (CAPACITY - 1);
+		Header* hd = header(offset);
+		if (hd->size == WRAP_MARKER) {
+			t += CAPACITY - offset;
+			offset = 0;
+			hd = header(0);
+		}
+		f(buffer + offset + sizeof(Header), (std::size_t)hd->size, hd->enqueueTime);
+		tail.store(t + recordSizeOf(hd->size), std::memory_order_release);
+		depth.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/** Consumer. Discards all queued packets, returns how many. */
+	int clear() {
+		int n = 0;
+		while (pop([](const char*, std::size_t, std::int64_t) {})) n++;
+		return n;
+	}
+
+	bool empty() const { return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire); }
+
+	/** Number of packets queued, from either thread */
+	int size() const { return depth.load(std::memory_order_relaxed); }
+
+   private:
+	static const std::uint32_t WRAP_MARKER = 0xFFFFFFFF;
+
+	alignas(16) char buffer[CAPACITY];
+	/** Monotonic byte positions, masked by CAPACITY - 1 to index the buffer */
+	std::atomic<std::size_t> head{0};
+	std::atomic<std::size_t> tail{0};
+	std::atomic<int> depth{0};
+
+	static std::size_t recordSizeOf(std::size_t size) {
+		return (sizeof(Header) + size + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+	}
+
+	Header* header(std::size_t offset) { return reinterpret_cast<Header*>(buffer + offset); }
+};
+
+}  // namespace TheModularMind
@@ -3,6 +3,9 @@
 #include <functional>
 #include <queue>
 #include "oscpack/osc/OscPacketListener.h"
+#include "OscInboundMessage.hpp"
+#include "OscValueTable.hpp"
+#include "OscListenerThread.hpp"
 
 /*
 This file was copied from https://github.com/The-Modular-Mind/oscelot
@@ -11,13 +14,25 @@ Modifications:
 
 Downgraded FATAL logging to WARN level
 Replaced OscMessage std::queue with VCVRack dsp::RingBuffer
+Queue fixed-size OscInboundMessage instead of heap-allocating OscMessage
+Optional address resolver run on the listener thread
+Optional value table receiving "<address> <index> <value>" messages instead of the queue
+Drain up to RECEIVE_BATCH_SIZE datagrams per socket wake-up
+Sockets are served by the shared OscListenerThread instead of one detached thread per receiver
 
 */
 
 namespace TheModularMind {
 
+template <int VALUE_TABLE_SIZE>
 struct OscReceiver : public osc::OscPacketListener {
    public:
+	/** Maps an OSC address to an application-defined id, stored in OscInboundMessage::addressId */
+	typedef int (*AddressResolver)(const char *address);
+
+	/** Maximum number of datagrams read from each socket per wake-up of the listener thread */
+	static const int RECEIVE_BATCH_SIZE = 32;
+
 	int port;
 
 	OscReceiver() {}
@@ -31,19 +46,10 @@ struct OscReceiver : public osc::OscPacketListener {
 		this->port = port;
 		this->queue.clear();
 
-		UdpListeningReceiveSocket *socket = nullptr;
+		UdpReceiveSocket *socket = nullptr;
 		try {
 			IpEndpointName name(IpEndpointName::ANY_ADDRESS, port);
-			socket = new UdpListeningReceiveSocket(name, this);
-
-			// Socket deleter
-			auto deleter = [](UdpListeningReceiveSocket *socket) {
-				socket->Break();
-				delete socket;
-			};
-
-			listenSocket = std::unique_ptr<UdpListeningReceiveSocket, decltype(deleter)>(socket, deleter);
-
+			socket = new UdpReceiveSocket(name);
 		} catch (std::exception &e) {
 			WARN("OscReceiver couldn't create receiver on port %i, %s", port, e.what());
 			if (socket != nullptr) {
@@ -53,24 +59,33 @@ struct OscReceiver : public osc::OscPacketListener {
 			return false;
 		}
 
-		listenThread = std::thread([this] { this->listenerProcess(); });
-		listenThread.detach();
-		return true;
-	}
+		// Socket deleter, no more packets are delivered to this receiver once detached
+		auto deleter = [this](UdpReceiveSocket *socket) {
+			OscListenerThread::instance().detach(socket, this);
+			delete socket;
+		};
 
-	void listenerProcess() {
-		while (listenSocket) {
-			try {
-				listenSocket->Run();
-			} catch (std::exception &e) {
-				WARN("OscReceiver error: %s", e.what());
-			}
-		}
+		OscListenerThread::instance().setReceiveBatchSize(RECEIVE_BATCH_SIZE);
+		OscListenerThread::instance().attach(socket, this);
+		listenSocket = std::unique_ptr<UdpReceiveSocket, std::function<void(UdpReceiveSocket *)>>(socket, deleter);
+		return true;
 	}
 
 	void stop() { listenSocket.reset(); }
 
-	bool shift(OscMessage *message) {
+	/** Must be set before start(), as the resolver is called from the listener thread */
+	void setAddressResolver(AddressResolver resolver) { addressResolver = resolver; }
+
+	/**
+	 * Messages resolved to addressId with two numeric arguments are written to the table as (index, value)
+	 * instead of being queued. Must be set before start(); the table must outlive the receiver.
+	 */
+	void setValueTable(OscValueTable<VALUE_TABLE_SIZE> *table, int addressId) {
+		valueTable = table;
+		valueTableAddressId = addressId;
+	}
+
+	bool shift(OscInboundMessage *message) {
 		if (!message) return false;
 		if (!queue.empty()) {
 			*message = queue.shift();
@@ -82,33 +97,66 @@ struct OscReceiver : public osc::OscPacketListener {
    protected:
 	/// process incoming OSC message and add it to the queue
 	virtual void ProcessMessage(const osc::ReceivedMessage &receivedMessage, const IpEndpointName &remoteEndpoint) override {
+		int addressId = addressResolver ? addressResolver(receivedMessage.AddressPattern()) : 0;
+		if (valueTable && addressId == valueTableAddressId && processValueMessage(receivedMessage)) return;
 		if (!queue.full()) {
-			OscMessage msg;
-			char endpointHost[IpEndpointName::ADDRESS_STRING_LENGTH];
-
-			remoteEndpoint.AddressAsString(endpointHost);
-			msg.setAddress(receivedMessage.AddressPattern());
-			msg.setRemoteEndpoint(endpointHost, remoteEndpoint.port);
+			OscInboundMessage msg;
+			msg.clear();
+			if (!msg.setAddress(receivedMessage.AddressPattern())) {
+				WARN("OscReceiver ProcessMessage(): address of message %s is too long", receivedMessage.AddressPattern());
+				return;
+			}
+			msg.addressId = addressId;
+			msg.setRemoteEndpoint(remoteEndpoint.address, remoteEndpoint.port);
 
 			for (auto arg = receivedMessage.ArgumentsBegin(); arg != receivedMessage.ArgumentsEnd(); ++arg) {
+				bool added;
 				if (arg->IsInt32()) {
-					msg.addIntArg(arg->AsInt32Unchecked());
+					added = msg.addIntArg(arg->AsInt32Unchecked());
 				} else if (arg->IsFloat()) {
-					msg.addFloatArg(arg->AsFloatUnchecked());
+					added = msg.addFloatArg(arg->AsFloatUnchecked());
 				} else if (arg->IsString()) {
-					msg.addStringArg(arg->AsStringUnchecked());
+					added = msg.addStringArg(arg->AsStringUnchecked());
 				} else {
 					WARN("OscReceiver ProcessMessage(): argument in message %s is an unknown type %d", receivedMessage.AddressPattern(), arg->TypeTag());
 					break;
 				}
+				if (!added) {
+					WARN("OscReceiver ProcessMessage(): arguments of message %s truncated after %d", receivedMessage.AddressPattern(), (int)msg.getNumArgs());
+					break;
+				}
 			}
 			queue.push(msg);
 		}
 	}
 
    private:
-	std::unique_ptr<UdpListeningReceiveSocket, std::function<void(UdpListeningReceiveSocket *)>> listenSocket;
-	dsp::RingBuffer<OscMessage, 512> queue;
-	std::thread listenThread;
+	/// returns true if the message was written to the value table
+	bool processValueMessage(const osc::ReceivedMessage &receivedMessage) {
+		if (receivedMessage.ArgumentCount() < 2) return false;
+		auto arg = receivedMessage.ArgumentsBegin();
+		std::int32_t index, value;
+		if (!argAsInt(*arg, index)) return false;
+		if (!argAsInt(*(++arg), value)) return false;
+		return valueTable->write(index, value);
+	}
+
+	static bool argAsInt(const osc::ReceivedMessageArgument &arg, std::int32_t &out) {
+		if (arg.IsInt32()) {
+			out = arg.AsInt32Unchecked();
+			return true;
+		}
+		if (arg.IsFloat()) {
+			out = (std::int32_t)arg.AsFloatUnchecked();
+			return true;
+		}
+		return false;
+	}
+
+	std::unique_ptr<UdpReceiveSocket, std::function<void(UdpReceiveSocket *)>> listenSocket;
+	dsp::RingBuffer<OscInboundMessage, 512> queue;
+	AddressResolver addressResolver = nullptr;
+	OscValueTable<VALUE_TABLE_SIZE> *valueTable = nullptr;
+	int valueTableAddressId = -1;
 };
 }  // namespace TheModularMind
\ No newline at end of file
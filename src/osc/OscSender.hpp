@@ -1,5 +1,11 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "OscBundle.hpp"
+#include "OscPacketQueue.hpp"
 #include "oscpack/ip/UdpSocket.h"
 #include "oscpack/osc/OscOutboundPacketStream.h"
 #include "oscpack/osc/OscTypes.h"
@@ -10,21 +16,44 @@ This file was originally copied from https://github.com/The-Modular-Mind/oscelot
 Modifications:
 
 * Removed some FATAL logging, and changed others to WARN
+* Encode into a reusable, MTU-sized buffer owned by the sender instead of a 320 KB stack array per send
+* Added sendPacket(encode) and sendMessage(address, args...) to serialise straight into the packet stream
+* Added beginBundle() / endBundle() to coalesce the messages sent in between into bundles of up to
+  getMaxDatagramSize() bytes
+* The encode buffer and pending bundle are used by one thread at a time, others are refused
+* Packets are handed to a transmit thread through an OscPacketQueue, so the sending thread never blocks in the
+  socket; queue depth, drops and send latency are reported by getQueueDepth() and friends
+* An OscBundle too large for the encode buffer is sent as several bundles, split between its elements
+* sendMessage() accepts osc::Blob arguments
 
 */
 
 namespace TheModularMind {
 
+/**
+ * Messages are encoded by one thread at a time (normally the engine thread) into a shared encode buffer, then
+ * queued for the sender's own transmit thread, which is the only one writing to the socket while it runs.
+ * A thread that calls beginBundle() keeps the encode buffer until its endBundle(); sends from other threads
+ * meanwhile are dropped with a warning rather than corrupting the bundle.
+ */
 class OscSender {
    public:
+	/** Largest UDP payload that fits an Ethernet frame without IP fragmentation (1500 - 20 IPv4 - 8 UDP) */
+	static const int MTU_DATAGRAM_SIZE = 1472;
+	/** Largest packet the encode buffer holds, the upper limit of setMaxDatagramSize() */
+	static const int ENCODE_BUFFER_SIZE = 8192;
+	/** Capacity of the fallback buffer used when an OscBundle or OscMessage does not fit ENCODE_BUFFER_SIZE */
+	static const int LARGE_BUFFER_SIZE = 327680;
+
 	std::string host;
 	int port = 0;
 
-	OscSender() {}
+	OscSender() : packet(encodeBuffer, ENCODE_BUFFER_SIZE) {}
 
 	~OscSender() { stop(); }
 
 	bool start(std::string &host, int port) {
+		stop();
 		this->host = host;
 		this->port = port;
 		if (host == "") {
@@ -50,45 +79,452 @@ class OscSender {
 			sendSocket.reset();
 			return false;
 		}
+
+		txDrops = 0;
+		txLatencyUs = 0;
+		txMaxLatencyUs = 0;
+		txPending = false;
+		transmitting = true;
+		try {
+			transmitThread = std::thread([this] { this->transmitProcess(); });
+			threaded = true;
+		} catch (std::system_error &e) {
+			WARN("OscSender couldn't start its transmit thread, sending synchronously: %s", e.what());
+			threaded = false;
+		}
+		connected = true;
 		return true;
 	}
 
-	void stop() { sendSocket.reset(); }
+	/** Sends what is still queued, then closes the socket. Later sends return false until start(). */
+	void stop() {
+		connected = false;
+		if (transmitThread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(txMutex);
+				transmitting = false;
+			}
+			txWakeup.notify_one();
+			transmitThread.join();
+		}
+		// A send racing with the line above may have queued one more packet
+		txQueue.clear();
+		sendSocket.reset();
+	}
+
+	/** Upper bound for bundles built between beginBundle() and endBundle(), clamped to 64..ENCODE_BUFFER_SIZE */
+	void setMaxDatagramSize(int size) {
+		maxDatagramSize = size < 64 ? 64 : size > ENCODE_BUFFER_SIZE ? ENCODE_BUFFER_SIZE : size;
+	}
+
+	int getMaxDatagramSize() { return maxDatagramSize; }
+
+	bool hasSocket() { return connected; }
+
+	/** Packets waiting for the transmit thread */
+	int getQueueDepth() { return txQueue.size(); }
 
-	bool hasSocket() {
-		if (!sendSocket) {
+	/** Packets dropped because the queue was full or they were too large for it, since start() */
+	int getDropCount() { return txDrops; }
+
+	/** Moving average of the time from queueing a packet to the end of its send, in microseconds */
+	int getSendLatencyUs() { return txLatencyUs; }
+
+	/** Longest time from queueing a packet to the end of its send since start(), in microseconds */
+	int getMaxSendLatencyUs() { return txMaxLatencyUs; }
+
+	/**
+	 * Encodes a packet by calling encode(osc::OutboundPacketStream&) on the encode buffer and queues it, e.g.
+	 * `sendPacket([&](osc::OutboundPacketStream &p) { p << osc::BeginMessage("/fader") << nprn << value << osc::EndMessage; })`.
+	 * The stream throws osc::OutOfBufferMemoryException once ENCODE_BUFFER_SIZE is exceeded. Returns false if
+	 * the packet was not queued.
+	 */
+	template <typename F>
+	bool sendPacket(F encode) {
+		if (!connected) {
 			return false;
-		} else {
-			return true;
 		}
+		EncoderLock lock(*this);
+		if (!lock) {
+			return false;
+		}
+		try {
+			encode(beginPacket());
+		} catch (osc::Exception &e) {
+			WARN("OscSender couldn't encode packet because of: %s", e.what());
+			return false;
+		}
+		return sendEncoded();
+	}
+
+	/**
+	 * Encodes and sends a single message with int, float and string arguments, without allocating:
+	 * `sendMessage("/fader", nprn, value)`. Returns false if not connected or the message does not fit.
+	 * Between beginBundle() and endBundle() the message is added to the pending bundle instead.
+	 */
+	template <typename... Args>
+	bool sendMessage(const char *address, const Args &... args) {
+		if (!connected) {
+			return false;
+		}
+		EncoderLock lock(*this);
+		if (!lock) {
+			return false;
+		}
+		if (bundling) {
+			return addToBundle(address, args...);
+		}
+		try {
+			beginPacket() << osc::BeginMessage(address);
+			appendArgs(args...);
+			packet << osc::EndMessage;
+		} catch (osc::Exception &e) {
+			WARN("OscSender couldn't encode %s because of: %s", address, e.what());
+			return false;
+		}
+		return sendEncoded();
+	}
+
+	/**
+	 * Until endBundle(), sendMessage(address, args...) packs messages into bundles instead of sending one
+	 * datagram each. A bundle is sent as soon as the next message would make it exceed getMaxDatagramSize().
+	 * The calling thread keeps the encode buffer until it calls endBundle(), so both belong in the same call.
+	 * Returns false if another thread is using the encode buffer, then each sendMessage() sends on its own and
+	 * returns false while it can't.
+	 */
+	bool beginBundle() {
+		EncoderLock lock(*this);
+		if (!lock.isAcquired()) {
+			return false;
+		}
+		lock.keep();
+		bundling = true;
+		return true;
+	}
+
+	/** Sends the pending bundle, if any, and returns to one datagram per sendMessage() */
+	void endBundle() {
+		if (encoderOwner.load() != std::this_thread::get_id() || !bundling) {
+			return;
+		}
+		flushBundle();
+		bundling = false;
+		encoderOwner.store(std::thread::id());
 	}
 
 	void sendBundle(const OscBundle &bundle) {
-		if (!sendSocket) {
+		if (!connected) {
+			return;
+		}
+		EncoderLock lock(*this);
+		if (!lock) {
 			return;
 		}
 
-		static const int OUTPUT_BUFFER_SIZE = 327680;
-		char buffer[OUTPUT_BUFFER_SIZE];
-		osc::OutboundPacketStream outputStream(buffer, OUTPUT_BUFFER_SIZE);
-		appendBundle(bundle, outputStream);
-		sendSocket->Send(outputStream.Data(), outputStream.Size());
+		try {
+			appendBundle(bundle, beginPacket());
+			sendEncoded();
+			return;
+		} catch (osc::OutOfBufferMemoryException &) {
+			// Too big for one datagram, sent as several
+		}
+		osc::OutboundPacketStream outputStream(largeBuffer(), LARGE_BUFFER_SIZE);
+		try {
+			appendBundle(bundle, outputStream);
+		} catch (osc::Exception &e) {
+			WARN("OscSender couldn't encode bundle because of: %s", e.what());
+			return;
+		}
+		transmitSplit(largeBuffer(), outputStream.Size());
 	}
 
 	void sendMessage(const OscMessage &message) {
-		if (!sendSocket) {
+		if (!connected) {
+			return;
+		}
+		EncoderLock lock(*this);
+		if (!lock) {
 			return;
 		}
 
-		static const int OUTPUT_BUFFER_SIZE = 327680;
-		char buffer[OUTPUT_BUFFER_SIZE];
-		osc::OutboundPacketStream outputStream(buffer, OUTPUT_BUFFER_SIZE);
-		appendMessage(message, outputStream);
-		sendSocket->Send(outputStream.Data(), outputStream.Size());
+		try {
+			appendMessage(message, beginPacket());
+			sendEncoded();
+			return;
+		} catch (osc::OutOfBufferMemoryException &) {
+			// Too big for one datagram, let the IP layer fragment it if the transmit queue takes it
+		}
+		osc::OutboundPacketStream outputStream(largeBuffer(), LARGE_BUFFER_SIZE);
+		try {
+			appendMessage(message, outputStream);
+		} catch (osc::Exception &e) {
+			WARN("OscSender couldn't encode %s because of: %s", message.getAddress().c_str(), e.what());
+			return;
+		}
+		transmit(outputStream.Data(), outputStream.Size());
 	}
 
    private:
 	std::unique_ptr<UdpTransmitSocket> sendSocket;
+	/** Set while a socket is open; checked by the sending thread */
+	std::atomic<bool> connected{false};
+	/** False if the transmit thread could not be started, then packets are sent synchronously */
+	bool threaded = false;
+
+	OscPacketQueue txQueue;
+	std::thread transmitThread;
+	std::atomic<bool> transmitting{false};
+	/** Only taken by the transmit thread and stop(), never by a sending thread */
+	std::mutex txMutex;
+	std::condition_variable txWakeup;
+	/** Set when a packet was queued since the transmit thread last drained the queue */
+	std::atomic<bool> txPending{false};
+	/**
+	 * A wakeup notified just before the transmit thread starts to wait is missed, as the sending thread does not
+	 * take txMutex. The thread then finds the packet when this wait times out.
+	 */
+	static const int TX_WAIT_TIMEOUT_MS = 5;
+	std::atomic<int> txDrops{0};
+	std::atomic<int> txLatencyUs{0};
+	std::atomic<int> txMaxLatencyUs{0};
+	/** Thread using the encode buffer and bundle state, none while they are free. See EncoderLock. */
+	std::atomic<std::thread::id> encoderOwner{std::thread::id()};
+	std::atomic<bool> encoderConflict{false};
+	char encodeBuffer[ENCODE_BUFFER_SIZE];
+	osc::OutboundPacketStream packet;
+	int maxDatagramSize = MTU_DATAGRAM_SIZE;
+	bool bundling = false;
+	/** Number of messages in the bundle pending in the encode buffer */
+	int bundleMessages = 0;
+	/** Allocated on first oversized OscBundle / OscMessage, then kept */
+	std::vector<char> largeEncodeBuffer;
+
+	/**
+	 * Claims the encode buffer for the calling thread while in scope, unless it already has it for its bundle.
+	 * Never blocks: false if another thread is using it.
+	 */
+	class EncoderLock {
+	   public:
+		EncoderLock(OscSender &sender) : sender(sender) {
+			std::thread::id self = std::this_thread::get_id();
+			if (sender.encoderOwner.load() == self) {
+				held = true;
+				return;
+			}
+			std::thread::id none;
+			held = acquired = sender.encoderOwner.compare_exchange_strong(none, self);
+			if (!held && !sender.encoderConflict.exchange(true)) {
+				WARN("OscSender is in use by another thread, dropping messages sent meanwhile");
+			}
+		}
+
+		~EncoderLock() {
+			if (acquired) {
+				sender.encoderOwner.store(std::thread::id());
+			}
+		}
+
+		explicit operator bool() const { return held; }
+
+		/** True if this lock claimed the buffer, rather than finding it claimed by the same thread */
+		bool isAcquired() const { return acquired; }
+
+		/** Leaves the buffer claimed after the lock goes out of scope */
+		void keep() { acquired = false; }
+
+	   private:
+		OscSender &sender;
+		bool held = false;
+		bool acquired = false;
+	};
+
+	/** Starts a new packet in the encode buffer, sending a pending bundle first */
+	osc::OutboundPacketStream &beginPacket() {
+		flushBundle();
+		packet.Clear();
+		return packet;
+	}
+
+	/** Queues the packet written since beginPacket() for sending. Returns false if it was not queued. */
+	bool sendEncoded() {
+		if (!connected || packet.Size() == 0) {
+			return false;
+		}
+		if (!packet.IsReady()) {
+			WARN("OscSender.sendEncoded(), packet has an unterminated message or bundle");
+			return false;
+		}
+		return transmit(packet.Data(), packet.Size());
+	}
+
+	char *largeBuffer() {
+		if (largeEncodeBuffer.empty()) {
+			largeEncodeBuffer.resize(LARGE_BUFFER_SIZE);
+		}
+		return largeEncodeBuffer.data();
+	}
+
+	static std::int64_t nowNs() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool transmit(const char *data, std::size_t size) {
+		if (threaded) {
+			if (size > OscPacketQueue::MAX_PACKET_SIZE) {
+				// Sending it from here would block the calling thread in the socket
+				WARN("OscSender dropped a packet of %i bytes, larger than the transmit queue takes", (int)size);
+				txDrops++;
+				return false;
+			}
+			if (!txQueue.push(data, size, nowNs())) {
+				txDrops++;
+				return false;
+			}
+			txPending = true;
+			txWakeup.notify_one();
+			return true;
+		}
+		// No transmit thread
+		try {
+			sendSocket->Send(data, size);
+		} catch (std::exception &e) {
+			WARN("OscSender couldn't send to %s:%i because of: %s", host.c_str(), port, e.what());
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Queues an encoded bundle as consecutive bundles of its elements, each up to getMaxDatagramSize() bytes
+	 * unless one element alone is larger. Overwrites the data of the elements already queued.
+	 */
+	bool transmitSplit(char *data, std::size_t size) {
+		// "#bundle" and the time tag, repeated in front of each part
+		const std::size_t HEADER_SIZE = 16;
+		char header[HEADER_SIZE];
+		std::memcpy(header, data, HEADER_SIZE);
+		auto transmitPart = [&](std::size_t begin, std::size_t end) -> bool {
+			// The bytes in front of the first element belong to the part queued before
+			std::memcpy(data + begin - HEADER_SIZE, header, HEADER_SIZE);
+			return transmit(data + begin - HEADER_SIZE, end - begin + HEADER_SIZE);
+		};
+		bool sent = true;
+		std::size_t begin = HEADER_SIZE;
+		std::size_t end = begin;
+		while (end + 4 <= size) {
+			const unsigned char *p = reinterpret_cast<const unsigned char *>(data + end);
+			std::size_t elementSize = 4 + ((std::size_t)p[0] << 24 | (std::size_t)p[1] << 16 | (std::size_t)p[2] << 8 | p[3]);
+			if (end + elementSize > size) {
+				break;
+			}
+			if (end > begin && end + elementSize - begin + HEADER_SIZE > (std::size_t)maxDatagramSize) {
+				sent = transmitPart(begin, end) && sent;
+				begin = end;
+			}
+			end += elementSize;
+		}
+		if (end > begin) {
+			sent = transmitPart(begin, end) && sent;
+		}
+		return sent;
+	}
+
+	void transmitProcess() {
+		float averageUs = 0.f;
+		auto send = [&](const char *data, std::size_t size, std::int64_t enqueueTime) {
+			try {
+				sendSocket->Send(data, size);
+			} catch (std::exception &e) {
+				WARN("OscSender couldn't send to %s:%i because of: %s", host.c_str(), port, e.what());
+			}
+			int latencyUs = (int)((nowNs() - enqueueTime) / 1000);
+			averageUs += (latencyUs - averageUs) * 0.05f;
+			txLatencyUs = (int)averageUs;
+			if (latencyUs > txMaxLatencyUs) txMaxLatencyUs = latencyUs;
+		};
+		std::unique_lock<std::mutex> lock(txMutex);
+		while (true) {
+			txPending = false;
+			lock.unlock();
+			while (txQueue.pop(send)) {}
+			lock.lock();
+			// Checked after draining, so packets queued before stop() are still sent
+			if (!transmitting) break;
+			txWakeup.wait_for(lock, std::chrono::milliseconds(TX_WAIT_TIMEOUT_MS), [this] { return txPending || !transmitting; });
+		}
+	}
+
+	template <typename... Args>
+	bool addToBundle(const char *address, const Args &... args) {
+		// Bundle element: 4-byte size prefix + message
+		std::size_t size = 4 + messageSize(address, args...);
+		if (bundleMessages > 0 && packet.Size() + size > (std::size_t)maxDatagramSize) {
+			flushBundle();
+		}
+		try {
+			if (bundleMessages == 0) {
+				packet.Clear();
+				packet << osc::BeginBundleImmediate;
+			}
+			packet << osc::BeginMessage(address);
+			appendArgs(args...);
+			packet << osc::EndMessage;
+		} catch (osc::Exception &e) {
+			// Only a message that alone exceeds the encode buffer gets here, so nothing else is lost
+			WARN("OscSender couldn't encode %s because of: %s", address, e.what());
+			packet.Clear();
+			bundleMessages = 0;
+			return false;
+		}
+		bundleMessages++;
+		return true;
+	}
+
+	void flushBundle() {
+		if (bundleMessages == 0) {
+			return;
+		}
+		bundleMessages = 0;
+		packet << osc::EndBundle;
+		sendEncoded();
+		packet.Clear();
+	}
+
+	/** Encoded size of a string including its terminator, padded to 4 bytes */
+	static std::size_t paddedSize(const char *s) { return (std::strlen(s) + 4) & ~(std::size_t)3; }
+
+	template <typename... Args>
+	static std::size_t messageSize(const char *address, const Args &... args) {
+		// Type tag string is ',' + one tag per argument + terminator
+		return paddedSize(address) + ((sizeof...(Args) + 2 + 3) & ~(std::size_t)3) + argsSize(args...);
+	}
+
+	static std::size_t argsSize() { return 0; }
+
+	template <typename T, typename... Rest>
+	static std::size_t argsSize(const T &arg, const Rest &... rest) {
+		return argSize(arg) + argsSize(rest...);
+	}
+
+	static std::size_t argSize(int) { return 4; }
+	static std::size_t argSize(float) { return 4; }
+	static std::size_t argSize(const char *arg) { return paddedSize(arg); }
+	static std::size_t argSize(const std::string &arg) { return paddedSize(arg.c_str()); }
+	static std::size_t argSize(const osc::Blob &arg) { return 4 + ((arg.size + 3) & ~(std::size_t)3); }
+
+	void appendArgs() {}
+
+	template <typename T, typename... Rest>
+	void appendArgs(const T &arg, const Rest &... rest) {
+		appendArg(arg);
+		appendArgs(rest...);
+	}
+
+	void appendArg(int arg) { packet << (osc::int32)arg; }
+	void appendArg(float arg) { packet << arg; }
+	void appendArg(const char *arg) { packet << arg; }
+	void appendArg(const std::string &arg) { packet << arg.c_str(); }
+	void appendArg(const osc::Blob &arg) { packet << arg; }
 
 	void appendBundle(const OscBundle &bundle, osc::OutboundPacketStream &outputStream) {
 		outputStream << osc::BeginBundleImmediate;
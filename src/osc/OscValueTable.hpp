@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/*
+Latest-value-wins table for indexed OSC values such as "/fader <id> <value>".
+
+The OSC listener thread writes each value into the slot of its index; the engine thread later consumes only
+the slots written since its previous pass. A burst of messages for the same index collapses into its newest
+value, so the table uses constant memory however fast values arrive.
+
+Single producer (listener thread), single consumer (engine thread).
+*/
+
+namespace TheModularMind {
+
+template <int SIZE>
+struct OscValueTable {
+	static const int WORDS = (SIZE + 63) / 64;
+
+	OscValueTable() {
+		for (int i = 0; i < SIZE; i++) {
+			slots[i].store(0);
+			readSeq[i] = 0;
+		}
+		for (int i = 0; i < WORDS; i++) {
+			dirty[i].store(0);
+		}
+	}
+
+	/** Listener thread. Returns false if the index is out of range. */
+	bool write(int index, std::int32_t value) {
+		if (index < 0 || index >= SIZE) return false;
+		// Sequence 0 is reserved for "never written"
+		if (++writeSeq == 0) writeSeq = 1;
+		slots[index].store(((std::uint64_t)writeSeq << 32) | (std::uint32_t)value, std::memory_order_release);
+		dirty[index >> 6].fetch_or((std::uint64_t)1 << (index & 63), std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Engine thread. Calls f(index, value) once for every slot written since the last call, with its newest value.
+	 * Returns the number of slots passed to f.
+	 */
+	template <typename F>
+	int consume(F f) {
+		int n = 0;
+		for (int w = 0; w < WORDS; w++) {
+			if (dirty[w].load(std::memory_order_relaxed) == 0) continue;
+			std::uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+			while (bits) {
+				int index = (w << 6) + __builtin_ctzll(bits);
+				bits &= bits - 1;
+				std::uint64_t slot = slots[index].load(std::memory_order_acquire);
+				std::uint32_t seq = (std::uint32_t)(slot >> 32);
+				// A value written between the exchange and the load above is seen now and flagged again for the
+				// next pass; the sequence number keeps it from being reported twice.
+				if (seq == readSeq[index]) continue;
+				readSeq[index] = seq;
+				f(index, (std::int32_t)(std::uint32_t)slot);
+				n++;
+			}
+		}
+		return n;
+	}
+
+   private:
+	/** Sequence number (high 32 bits) and value (low 32 bits) of each index */
+	std::atomic<std::uint64_t> slots[SIZE];
+	/** One bit per index written but not yet consumed */
+	std::atomic<std::uint64_t> dirty[WORDS];
+	/** Listener thread only */
+	std::uint32_t writeSeq = 0;
+	/** Engine thread only */
+	std::uint32_t readSeq[SIZE];
+};
+
+}  // namespace TheModularMind
@@ -69,6 +69,11 @@ public:
             int initialDelayMilliseconds, int periodMilliseconds, TimerListener *listener );
     void DetachPeriodicTimerListener( TimerListener *listener );  
 
+    // receive up to maxDatagrams pending datagrams per socket on each wake-up
+    // and pass them to the listener in one pass (default 1). uses recvmmsg()
+    // where available. only call before calling Run
+    void SetReceiveBatchSize( int maxDatagrams );
+
     void Run();      // loop and block processing messages indefinitely
 	void RunUntilSigInt();
     void Break();    // call this from a listener to exit once the listener returns
@@ -166,6 +171,7 @@ public:
         { mux_.DetachSocketListener( this, listener_ ); }
 
     // see SocketReceiveMultiplexer above for the behaviour of these methods...
+    void SetReceiveBatchSize( int maxDatagrams ) { mux_.SetReceiveBatchSize( maxDatagrams ); }
     void Run() { mux_.Run(); }
 	void RunUntilSigInt() { mux_.RunUntilSigInt(); }
     void Break() { mux_.Break(); }
@@ -60,6 +60,15 @@
 #include "../PacketListener.h"
 #include "../TimerListener.h"
 
+// On Linux the multiplexer waits with epoll, breaks through an eventfd and
+// schedules timers through a timerfd. Define OSCPACK_NO_EPOLL to use select().
+#if defined(__linux__) && !defined(OSCPACK_NO_EPOLL)
+#define OSCPACK_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
 
 #if defined(__APPLE__) && !defined(_SOCKLEN_T)
 // pre system 10.3 didn't have socklen_t
@@ -316,6 +325,81 @@ struct AttachedTimerListener{
 };
 
 
+// Preallocated buffer ring for draining several datagrams from a socket per wake-up.
+// On Linux all pending datagrams (up to the ring size) are read with a single recvmmsg() call,
+// elsewhere with non-blocking recvfrom() calls until the socket is empty.
+class ReceiveBatch{
+	int count_;
+	std::size_t bufferSize_;
+	std::vector<char> buffers_;
+	std::vector<std::size_t> sizes_;
+	std::vector<IpEndpointName> endpoints_;
+	std::vector<struct sockaddr_in> fromAddrs_;
+#ifdef __linux__
+	std::vector<struct iovec> iovecs_;
+	std::vector<struct mmsghdr> msgs_;
+#endif
+
+public:
+	ReceiveBatch( int count, std::size_t bufferSize )
+		: count_( count )
+		, bufferSize_( bufferSize )
+		, buffers_( count * bufferSize )
+		, sizes_( count )
+		, endpoints_( count )
+		, fromAddrs_( count )
+#ifdef __linux__
+		, iovecs_( count )
+		, msgs_( count )
+#endif
+	{
+#ifdef __linux__
+		std::memset( &msgs_[0], 0, count * sizeof(struct mmsghdr) );
+		for( int i = 0; i < count; ++i ){
+			iovecs_[i].iov_base = Data( i );
+			iovecs_[i].iov_len = bufferSize_;
+			msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+			msgs_[i].msg_hdr.msg_iovlen = 1;
+			msgs_[i].msg_hdr.msg_name = &fromAddrs_[i];
+		}
+#endif
+	}
+
+	// returns the number of datagrams received, never blocks
+	int Receive( int socket )
+	{
+		int n = 0;
+#ifdef __linux__
+		for( int i = 0; i < count_; ++i )
+			msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		n = recvmmsg( socket, &msgs_[0], count_, MSG_DONTWAIT, 0 );
+		if( n < 0 )
+			return 0;
+		for( int i = 0; i < n; ++i )
+			sizes_[i] = msgs_[i].msg_len;
+#else
+		while( n < count_ ){
+			socklen_t fromAddrLen = sizeof(struct sockaddr_in);
+			ssize_t result = recvfrom( socket, Data( n ), bufferSize_, MSG_DONTWAIT,
+					(struct sockaddr *) &fromAddrs_[n], &fromAddrLen );
+			if( result < 0 )
+				break;
+			sizes_[n++] = (std::size_t)result;
+		}
+#endif
+		for( int i = 0; i < n; ++i ){
+			endpoints_[i].address = ntohl( fromAddrs_[i].sin_addr.s_addr );
+			endpoints_[i].port = ntohs( fromAddrs_[i].sin_port );
+		}
+		return n;
+	}
+
+	char *Data( int i ) { return &buffers_[ i * bufferSize_ ]; }
+	std::size_t Size( int i ) const { return sizes_[i]; }
+	const IpEndpointName& Endpoint( int i ) const { return endpoints_[i]; }
+};
+
+
 static bool CompareScheduledTimerCalls( 
 		const std::pair< double, AttachedTimerListener > & lhs, const std::pair< double, AttachedTimerListener > & rhs )
 {
@@ -338,7 +422,12 @@ class SocketReceiveMultiplexer::Implementation{
 	std::vector< AttachedTimerListener > timerListeners_;
 
 	volatile bool break_;
+#ifdef OSCPACK_USE_EPOLL
+	int breakEvent_; // eventfd
+#else
 	int breakPipe_[2]; // [0] is the reader descriptor and [1] the writer
+#endif
+	int receiveBatchSize_;
 
 	double GetCurrentTimeMs() const
 	{
@@ -351,15 +440,26 @@ class SocketReceiveMultiplexer::Implementation{
 
 public:
     Implementation()
+		: break_( false )
+		, receiveBatchSize_( 1 )
 	{
+#ifdef OSCPACK_USE_EPOLL
+		if( (breakEvent_ = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC )) == -1 )
+			throw std::runtime_error( "creation of asynchronous break eventfd failed\n" );
+#else
 		if( pipe(breakPipe_) != 0 )
 			throw std::runtime_error( "creation of asynchronous break pipes failed\n" );
+#endif
 	}
 
     ~Implementation()
 	{
+#ifdef OSCPACK_USE_EPOLL
+		close( breakEvent_ );
+#else
 		close( breakPipe_[0] );
 		close( breakPipe_[1] );
+#endif
 	}
 
     void AttachSocketListener( UdpSocket *socket, PacketListener *listener )
@@ -402,10 +502,147 @@ public:
 		timerListeners_.erase( i );
 	}
 
+    void SetReceiveBatchSize( int maxDatagrams )
+	{
+		receiveBatchSize_ = std::max( 1, maxDatagrams );
+	}
+
+#ifdef OSCPACK_USE_EPOLL
+    void Run()
+	{
+        // epoll_event data for the break and timer descriptors, sockets use their index in socketListeners_
+        const uint32_t BREAK_EVENT = 0xFFFFFFFF;
+        const uint32_t TIMER_EVENT = 0xFFFFFFFE;
+        const int MAX_EVENTS = 16;
+        const int MAX_BUFFER_SIZE = 4098;
+
+        int epollFd = -1;
+        int timerFd = -1;
+
+        try{
+            if( (epollFd = epoll_create1( EPOLL_CLOEXEC )) == -1 )
+                throw std::runtime_error("epoll_create1 failed\n");
+            if( (timerFd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC )) == -1 )
+                throw std::runtime_error("timerfd_create failed\n");
+
+            struct epoll_event ev;
+            std::memset( &ev, 0, sizeof(ev) );
+            ev.events = EPOLLIN;
+
+            // in addition to listening to the inbound sockets we also listen to the
+            // asynchronous break eventfd, so that AsynchronousBreak() can break us out
+            // of epoll_wait() from another thread, and to the timer queue's timerfd.
+            ev.data.u32 = BREAK_EVENT;
+            if( epoll_ctl( epollFd, EPOLL_CTL_ADD, breakEvent_, &ev ) == -1 )
+                throw std::runtime_error("epoll_ctl failed\n");
+            ev.data.u32 = TIMER_EVENT;
+            if( epoll_ctl( epollFd, EPOLL_CTL_ADD, timerFd, &ev ) == -1 )
+                throw std::runtime_error("epoll_ctl failed\n");
+            for( std::size_t i = 0; i < socketListeners_.size(); ++i ){
+                ev.data.u32 = (uint32_t)i;
+                if( epoll_ctl( epollFd, EPOLL_CTL_ADD, socketListeners_[i].second->impl_->Socket(), &ev ) == -1 )
+                    throw std::runtime_error("epoll_ctl failed\n");
+            }
+
+            // configure the timer queue
+            double currentTimeMs = GetCurrentTimeMs();
+
+            // expiry time ms, listener
+            std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
+            for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+                    i != timerListeners_.end(); ++i )
+                timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
+            std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+
+            // sockets are always read without blocking, so a batch size of one is fine here
+            ReceiveBatch batch( receiveBatchSize_, MAX_BUFFER_SIZE );
+            struct epoll_event events[ MAX_EVENTS ];
+
+            while( !break_ ){
+                if( !timerQueue_.empty() ){
+                    double timeoutMs = timerQueue_.front().first - GetCurrentTimeMs();
+                    // an all-zero it_value would disarm the timer, so expire after at least 1ns
+                    long long timeoutNs = timeoutMs > 0 ? (long long)(timeoutMs * 1000000.) : 0;
+                    if( timeoutNs < 1 )
+                        timeoutNs = 1;
+                    struct itimerspec spec;
+                    std::memset( &spec, 0, sizeof(spec) );
+                    spec.it_value.tv_sec = (time_t)(timeoutNs / 1000000000);
+                    spec.it_value.tv_nsec = (long)(timeoutNs % 1000000000);
+                    timerfd_settime( timerFd, 0, &spec, 0 );
+                }
+
+                int n = epoll_wait( epollFd, events, MAX_EVENTS, -1 );
+                if( n < 0 ){
+                    if( break_ )
+                        break;
+                    else if( errno == EINTR )
+                        continue;
+                    else
+                        throw std::runtime_error("epoll_wait failed\n");
+                }
+
+                for( int e = 0; e < n && !break_; ++e ){
+                    uint32_t id = events[e].data.u32;
+                    if( id == BREAK_EVENT ){
+                        // clear the pending asynchronous break
+                        uint64_t value;
+                        if( read( breakEvent_, &value, sizeof(value) ) < 0 && errno != EAGAIN && errno != EINTR )
+                            throw std::runtime_error("read of break event failed\n");
+                    }else if( id == TIMER_EVENT ){
+                        uint64_t expirations;
+                        // EAGAIN if the timer was re-armed since epoll_wait returned
+                        if( read( timerFd, &expirations, sizeof(expirations) ) < 0 && errno != EAGAIN && errno != EINTR )
+                            throw std::runtime_error("read of timer failed\n");
+                    }else if( id < socketListeners_.size() ){
+                        std::pair< PacketListener*, UdpSocket* >& socketListener = socketListeners_[id];
+                        int received = batch.Receive( socketListener.second->impl_->Socket() );
+                        for( int j = 0; j < received && !break_; ++j ){
+                            if( batch.Size( j ) > 0 )
+                                socketListener.first->ProcessPacket( batch.Data( j ), (int)batch.Size( j ), batch.Endpoint( j ) );
+                        }
+                    }
+                }
+
+                if( break_ )
+                    break;
+
+                // execute any expired timers
+                currentTimeMs = GetCurrentTimeMs();
+                bool resort = false;
+                for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
+                        i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
+
+                    i->second.listener->TimerExpired();
+                    if( break_ )
+                        break;
+
+                    i->first += i->second.periodMs;
+                    resort = true;
+                }
+                if( resort )
+                    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+            }
+        }catch(...){
+            if( timerFd != -1 )
+                close( timerFd );
+            if( epollFd != -1 )
+                close( epollFd );
+            break_ = false;
+            throw;
+        }
+
+        close( timerFd );
+        close( epollFd );
+
+        // reset on exit rather than on entry, so a break requested before Run() started is not lost
+        break_ = false;
+	}
+#else
     void Run()
 	{
-		break_ = false;
         char *data = 0;
+        ReceiveBatch *batch = 0;
         
         try{
             
@@ -442,6 +679,8 @@ public:
 
             const int MAX_BUFFER_SIZE = 4098;
             data = new char[ MAX_BUFFER_SIZE ];
+            if( receiveBatchSize_ > 1 )
+                batch = new ReceiveBatch( receiveBatchSize_, MAX_BUFFER_SIZE );
             IpEndpointName remoteEndpoint;
 
             struct timeval timeout;
@@ -490,6 +729,17 @@ public:
 
                     if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
 
+                        if( batch ){
+                            int n = batch->Receive( i->second->impl_->Socket() );
+                            for( int j = 0; j < n && !break_; ++j ){
+                                if( batch->Size( j ) > 0 )
+                                    i->first->ProcessPacket( batch->Data( j ), (int)batch->Size( j ), batch->Endpoint( j ) );
+                            }
+                            if( break_ )
+                                break;
+                            continue;
+                        }
+
                         std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
                         if( size > 0 ){
                             i->first->ProcessPacket( data, (int)size, remoteEndpoint );
@@ -517,12 +767,19 @@ public:
             }
 
             delete [] data;
+            delete batch;
         }catch(...){
             if( data )
                 delete [] data;
+            delete batch;
+            break_ = false;
             throw;
         }
+
+        // reset on exit rather than on entry, so a break requested before Run() started is not lost
+        break_ = false;
 	}
+#endif
 
     void Break()
 	{
@@ -533,8 +790,16 @@ public:
 	{
 		break_ = true;
 
+#ifdef OSCPACK_USE_EPOLL
+		// Signal the asynchronous break eventfd, so epoll_wait() will return
+		// EAGAIN only if the counter is saturated, so a break is pending anyway
+		uint64_t value = 1;
+		if( write( breakEvent_, &value, sizeof(value) ) < 0 && errno != EAGAIN )
+			throw std::runtime_error("write to break event failed\n");
+#else
 		// Send a termination message to the asynchronous break pipe, so select() will return
 		write( breakPipe_[1], "!", 1 );
+#endif
 	}
 };
 
@@ -575,6 +840,11 @@ void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *liste
 	impl_->DetachPeriodicTimerListener( listener );
 }
 
+void SocketReceiveMultiplexer::SetReceiveBatchSize( int maxDatagrams )
+{
+	impl_->SetReceiveBatchSize( maxDatagrams );
+}
+
 void SocketReceiveMultiplexer::Run()
 {
 	impl_->Run();
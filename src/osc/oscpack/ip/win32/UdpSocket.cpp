@@ -336,6 +336,7 @@ class SocketReceiveMultiplexer::Implementation{
 
 	volatile bool break_;
 	HANDLE breakEvent_;
+	int receiveBatchSize_;
 
 	double GetCurrentTimeMs() const
 	{
@@ -348,6 +349,8 @@ class SocketReceiveMultiplexer::Implementation{
 
 public:
     Implementation()
+		: break_( false )
+		, receiveBatchSize_( 1 )
 	{
 		breakEvent_ = CreateEvent( NULL, FALSE, FALSE, NULL );
 	}
@@ -397,10 +400,13 @@ public:
 		timerListeners_.erase( i );
 	}
 
-    void Run()
+    void SetReceiveBatchSize( int maxDatagrams )
 	{
-		break_ = false;
+		receiveBatchSize_ = (std::max)( 1, maxDatagrams );
+	}
 
+    void Run()
+	{
 		// prepare the window events which we use to wake up on incoming data
 		// we use this instead of select() primarily to support the AsyncBreak() 
 		// mechanism.
@@ -451,12 +457,15 @@ public:
 
 			if( waitResult != WAIT_TIMEOUT ){
 				for( int i = waitResult - WAIT_OBJECT_0; i < (int)socketListeners_.size(); ++i ){
-					std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-					if( size > 0 ){
-						socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
-						if( break_ )
+					// the sockets are non-blocking here, so drain up to receiveBatchSize_ pending datagrams
+					for( int j = 0; j < receiveBatchSize_ && !break_; ++j ){
+						std::size_t size = socketListeners_[i].second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
+						if( size == 0 )
 							break;
+						socketListeners_[i].first->ProcessPacket( data, (int)size, remoteEndpoint );
 					}
+					if( break_ )
+						break;
 				}
 			}
 
@@ -489,6 +498,9 @@ public:
 			unsigned long enableNonblocking = 0;
 			ioctlsocket( i->second->impl_->Socket(), FIONBIO, &enableNonblocking );  // make the socket blocking again
 		}
+
+		// reset on exit rather than on entry, so a break requested before Run() started is not lost
+		break_ = false;
 	}
 
     void Break()
@@ -540,6 +552,11 @@ void SocketReceiveMultiplexer::DetachPeriodicTimerListener( TimerListener *liste
 	impl_->DetachPeriodicTimerListener( listener );
 }
 
+void SocketReceiveMultiplexer::SetReceiveBatchSize( int maxDatagrams )
+{
+	impl_->SetReceiveBatchSize( maxDatagrams );
+}
+
 void SocketReceiveMultiplexer::Run()
 {
 	impl_->Run();